@@ -0,0 +1,224 @@
+#include "AssetManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+#include "ObjFileParser.h"
+#include "TextureArray.h"
+#include "ThreadPool.h"
+
+using std::future, std::make_shared, std::shared_ptr, std::string, std::vector;
+
+void
+AssetManager::
+preload(const vector<string>& _objFiles, const vector<string>& _mtlFiles) {
+  ThreadPool pool;
+  // parse all files not loaded yet, materials first since their textures
+  // can only be queued once they are parsed
+  vector<std::pair<string, future<MaterialConfig>>> materials;
+  for (auto& file : _mtlFiles) {
+    string k = key(file);
+    if (m_materials.count(k) == 0) {
+      m_materials[k] = nullptr; // reserve, so duplicates are queued once
+      materials.emplace_back(k, pool.submit(
+          [file]() { return parseMaterialFile(file); }));
+    }
+  }
+  // meshes and textures may be referenced several times, and their cache
+  // entries stay expired until loaded, so queued keys are tracked separately
+  std::unordered_set<string> queuedMeshes;
+  vector<std::pair<string, future<Mesh>>> meshes;
+  for (auto& file : _objFiles) {
+    string k = key(file);
+    bool isLoaded = m_meshes.count(k) != 0 && !m_meshes[k].expired();
+    if (!isLoaded && queuedMeshes.insert(k).second) {
+      meshes.emplace_back(k, pool.submit(
+          [file]() { return parseObjFile(file); }));
+    }
+  }
+
+  // decode textures of every material
+  std::unordered_set<string> queuedImages;
+  vector<std::pair<string, future<Texture::Image>>> images;
+  auto queueImage = [&](bool hasMap, const string& file,
+                        Texture::Content content = Texture::Content::COLOR) {
+    if (!hasMap || m_textureStreamer) {
+      return;
+    }
+    string k = key(file);
+    bool isLoaded = m_textures.count(k) != 0 && !m_textures[k].expired();
+    if (!isLoaded && queuedImages.insert(k).second) {
+      images.emplace_back(k, pool.submit(
+          [file, content, settings = m_textureSettings]() {
+            return Texture::load(file, settings, content);
+          }));
+    }
+  };
+  vector<std::pair<string, MaterialConfig>> parsedMaterials;
+  for (auto& [k, material] : materials) {
+    MaterialConfig m = material.get();
+    queueImage(m.hasKdMap, m.kdTextureFile);
+    queueImage(m.hasKsMap, m.ksTextureFile);
+    queueImage(m.hasKeMap, m.keTextureFile);
+    queueImage(m.hasNormalMap, m.normalTextureFile, Texture::Content::NORMAL_MAP);
+    queueImage(m.hasParallaxMap, m.parallaxTextureFile);
+    parsedMaterials.emplace_back(k, std::move(m));
+  }
+
+  // upload textures on this (GL) thread as soon as each is decoded, in
+  // whatever order they finish, or once all are when they are packed by size
+  if (m_textureSettings.hasTextureArrays) {
+    vector<Texture::Image> decoded;
+    for (auto& [k, image] : images) {
+      decoded.push_back(image.get());
+    }
+    vector<shared_ptr<const Texture>> textures = 
+        packTextureArrays(std::move(decoded));
+    for (size_t i = 0; i < images.size(); i++) {
+      m_textures[images[i].first] = textures[i];
+      m_preloaded.push_back(textures[i]);
+    }
+  } else {
+    size_t nPending = images.size();
+    while (nPending > 0) {
+      future<Texture::Image>* pending = nullptr;
+      bool isUploaded = false;
+      for (auto& [k, image] : images) {
+        if (!image.valid()) {
+          // already uploaded
+          continue;
+        }
+        if (image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+          pending = &image;
+          continue;
+        }
+        shared_ptr<const Texture> texture = 
+            make_shared<const Texture>(image.get(), m_textureSettings);
+        m_textures[k] = texture;
+        m_preloaded.push_back(texture);
+        nPending--;
+        isUploaded = true;
+      }
+      // nothing was ready, wait a little for the decoders
+      if (!isUploaded && pending) {
+        pending->wait_for(std::chrono::milliseconds(1));
+      }
+    }
+  }
+  for (auto& [k, m] : parsedMaterials) {
+    resolveTextures(m);
+    m_materials[k] = make_shared<const MaterialConfig>(std::move(m));
+  }
+  for (auto& [k, mesh] : meshes) {
+    shared_ptr<const Mesh> loaded = make_shared<const Mesh>(mesh.get());
+    m_meshes[k] = loaded;
+    m_preloaded.push_back(loaded);
+  }
+}
+
+void
+AssetManager::
+resolveTextures(MaterialConfig& m) {
+  // placeholders of streamed maps: gray color, no specular or emission, flat
+  // normal and no parallax depth
+  const glm::u8vec4 gray(128, 128, 128, 255), black(0, 0, 0, 255);
+  if (m.hasKdMap) m.kdTexture = getTexture(m.kdTextureFile, gray);
+  if (m.hasKsMap) m.ksTexture = getTexture(m.ksTextureFile, black);
+  if (m.hasKeMap) m.keTexture = getTexture(m.keTextureFile, black);
+  if (m.hasNormalMap) m.normalTexture = getTexture(m.normalTextureFile,
+      glm::u8vec4(128, 128, 255, 255), Texture::Content::NORMAL_MAP);
+  if (m.hasParallaxMap) m.parallaxTexture = getTexture(m.parallaxTextureFile, black);
+}
+
+std::string
+AssetManager::
+key(const string& _file) {
+  std::error_code ec;
+  std::filesystem::path path = std::filesystem::canonical(_file, ec);
+  // file doesn't exist, let the loader report it
+  return ec ? _file : path.string();
+}
+
+shared_ptr<const Mesh>
+AssetManager::
+getMesh(const string& _objFile) {
+  std::weak_ptr<const Mesh>& cached = m_meshes[key(_objFile)];
+  shared_ptr<const Mesh> mesh = cached.lock();
+  if (!mesh) {
+    mesh = make_shared<const Mesh>(parseObjFile(_objFile));
+    cached = mesh;
+  }
+  return mesh;
+}
+
+shared_ptr<const MaterialConfig>
+AssetManager::
+getMaterial(const string& _mtlFile) {
+  shared_ptr<const MaterialConfig>& material = m_materials[key(_mtlFile)];
+  if (!material) {
+    MaterialConfig m = parseMaterialFile(_mtlFile);
+    resolveTextures(m);
+    material = make_shared<const MaterialConfig>(std::move(m));
+  }
+  return material;
+}
+
+shared_ptr<const Texture>
+AssetManager::
+getTexture(const string& _imgFile, glm::u8vec4 _placeholder,
+           Texture::Content _content) {
+  std::weak_ptr<const Texture>& cached = m_textures[key(_imgFile)];
+  shared_ptr<const Texture> texture = cached.lock();
+  if (!texture) {
+    if (m_textureStreamer) {
+      texture = m_textureStreamer->request(_imgFile, _placeholder);
+    } else if (m_textureSettings.hasTextureArrays) {
+      vector<Texture::Image> images;
+      images.push_back(Texture::load(_imgFile, m_textureSettings, _content));
+      texture = packTextureArrays(std::move(images))[0];
+    } else {
+      texture = make_shared<const Texture>(_imgFile, m_textureSettings, _content);
+    }
+    cached = texture;
+  }
+  return texture;
+}
+
+vector<shared_ptr<const Texture>>
+AssetManager::
+packTextureArrays(vector<Texture::Image>&& _images) {
+  vector<shared_ptr<const Texture>> textures(_images.size());
+  // images by size and format, images that failed to load are left as
+  // invalid textures
+  std::map<std::tuple<int, int, GLenum>, vector<size_t>> formats;
+  for (size_t i = 0; i < _images.size(); i++) {
+    const Texture::Image& image = _images[i];
+    if (image.data || !image.compressedData.empty()) {
+      formats[{image.width, image.height, image.compressedFormat}].push_back(i);
+    } else {
+      textures[i] = make_shared<const Texture>(std::move(_images[i]), 
+                                               m_textureSettings);
+    }
+  }
+  size_t maxLayers = TextureArray::getMaxLayers();
+  for (auto& [format, indices] : formats) {
+    auto [width, height, compressedFormat] = format;
+    for (size_t first = 0; first < indices.size(); first += maxLayers) {
+      int nLayers = std::min(maxLayers, indices.size() - first);
+      auto array = make_shared<TextureArray>(width, height, nLayers, 
+                                             compressedFormat);
+      for (int layer = 0; layer < nLayers; layer++) {
+        size_t i = indices[first + layer];
+        textures[i] = make_shared<const Texture>(std::move(_images[i]), array, 
+                                                 layer, m_textureSettings);
+      }
+    }
+  }
+  return textures;
+}
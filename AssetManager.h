@@ -0,0 +1,103 @@
+#ifndef ASSET_MANAGER_H_
+#define ASSET_MANAGER_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Material.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "TextureStreamer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Load mesh, material and texture files at most once, and share them
+/// between all objects that reference the same file.
+///
+/// Assets are keyed by their canonical file path, so different spellings of
+/// the same path resolve to the same asset. Materials are small and copied into
+/// objects, so they are held strongly, and with them the textures they
+/// reference. Preloaded assets are held strongly too. Meshes, and textures
+/// loaded on their own, are otherwise only held weakly, so they are freed once
+/// the last object using them is destroyed.
+class AssetManager
+{
+  public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Load the given files and the textures they reference
+    /// concurrently, so later get* calls for them return immediately.
+    ///
+    /// Parsing and image decoding run on a thread pool, while GL uploads run
+    /// on the calling thread, which must own the GL context. Preloaded assets
+    /// are kept alive for the lifetime of the manager. Images of streamed
+    /// textures are left to the streamer.
+    void preload(const std::vector<std::string>& _objFiles,
+                 const std::vector<std::string>& _mtlFiles);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the mesh from an obj file, parsing it if not loaded yet
+    std::shared_ptr<const Mesh> getMesh(const std::string& _objFile);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the material from an mtl file, parsing it if not loaded yet.
+    /// Textures referenced by the material are also loaded through the manager.
+    std::shared_ptr<const MaterialConfig> getMaterial(const std::string& _mtlFile);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the texture from an image file, loading it if not loaded yet
+    /// @param _placeholder Color of the texture until its image is streamed in,
+    ///                     if textures are streamed
+    /// @param _content     What the image holds, to pick its compression
+    std::shared_ptr<const Texture> getTexture(
+        const std::string& _imgFile,
+        glm::u8vec4 _placeholder = glm::u8vec4(128, 128, 128, 255),
+        Texture::Content _content = Texture::Content::COLOR);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Store textures loaded afterwards as the renderer asks for. With
+    /// texture arrays, they are packed as layers of arrays, one per image
+    /// size, so that objects with different maps of the same size bind the
+    /// same textures. Preloaded images of the same size share an array, others
+    /// get an array of their own. Ignored for streamed textures.
+    void setTextureSettings(const Texture::Settings& _settings) {
+      m_textureSettings = _settings;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Load textures requested afterwards through a streamer, which
+    /// must outlive them, instead of synchronously
+    void setTextureStreamer(TextureStreamer* _streamer) {
+      m_textureStreamer = _streamer;
+    }
+
+  private:
+    template<typename T>
+    using Cache = std::unordered_map<std::string, std::weak_ptr<const T>>;
+
+    Cache<Mesh>    m_meshes;
+    Cache<Texture> m_textures;
+    std::unordered_map<std::string, std::shared_ptr<const MaterialConfig>> m_materials;
+    /// Preloaded meshes and textures, kept alive until the manager is destroyed
+    std::vector<std::shared_ptr<const void>> m_preloaded;
+    TextureStreamer* m_textureStreamer{nullptr}; ///< Null to load synchronously
+    Texture::Settings m_textureSettings; ///< Storage of new textures
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Look up the textures of a material in the texture cache, loading
+    /// any that are missing
+    void resolveTextures(MaterialConfig& _material);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Create textures as layers of new texture arrays, grouping images
+    /// of the same size in as few arrays as possible
+    /// @return Texture of each image, in the same order
+    std::vector<std::shared_ptr<const Texture>> packTextureArrays(
+        std::vector<Texture::Image>&& _images);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Key identifying a file regardless of how its path is written
+    static std::string key(const std::string& _file);
+};
+
+#endif // ASSET_MANAGER_H_
@@ -8,11 +8,24 @@ BezierSurface(const std::vector<glm::vec3>& _controlPoints,
               const MaterialConfig& _materialConfig,
               const glm::mat4& _transform)
   : RasterizableObject(
-      generateMesh(_controlPoints, 10),
+      generateMesh(_controlPoints, PREC),
       _materialConfig,
       _transform
     )
-{};
+{
+  // A level is drawn until its segments, about 2*r/prec long for a patch
+  // within a sphere of radius r, get too long on screen. Then the next finer
+  // level is needed.
+  std::vector<Mesh> meshes{};
+  std::vector<float> minScreenRadii{};
+  for (int prec : LOD_PRECS) {
+    meshes.push_back(prec == PREC ? *m_mesh : generateMesh(_controlPoints, prec));
+    minScreenRadii.push_back(prec / 2 * LOD_SEGMENT_PIXELS / 2);
+  }
+  setLods(meshes, minScreenRadii);
+};
+
+const int BezierSurface::LOD_PRECS[] = {40, 20, 10, 5};
 
 Mesh
 BezierSurface::
@@ -12,5 +12,11 @@ class BezierSurface : public RasterizableObject
       const glm::mat4& _transform);
 
   private:
+    /// Number of segments along each side of the ray traced mesh, and of the
+    /// levels of detail rasterized, from finest to coarsest
+    static const int PREC = 10;
+    static const int N_LODS = 4;
+    static const int LOD_PRECS[N_LODS];
+
     static Mesh generateMesh(const std::vector<glm::vec3>& _controlPoints, int _prec);
 };
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+using std::vector;
+
+/// Texels of a 4x4 block, row by row
+using Block = unsigned char[16][4];
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gather the block at block coordinate (_bx, _by)
+static void
+loadBlock(const unsigned char* _rgba, int _width, int _height,
+          int _bx, int _by, Block& _block) {
+  for (int y = 0; y < 4; y++) {
+    int sy = std::min(_by * 4 + y, _height - 1);
+    for (int x = 0; x < 4; x++) {
+      int sx = std::min(_bx * 4 + x, _width - 1);
+      const unsigned char* t = &_rgba[((size_t)sy * _width + sx) * 4];
+      std::copy(t, t + 4, _block[y * 4 + x]);
+    }
+  }
+}
+
+static void
+appendLittleEndian(vector<unsigned char>& _out, uint64_t _value, int _nBytes) {
+  for (int i = 0; i < _nBytes; i++) {
+    _out.push_back((unsigned char)(_value >> (8 * i)));
+  }
+}
+
+static uint16_t
+toRgb565(glm::vec3 _color) {
+  auto quantize = [](float _c, int _max) {
+    return (uint16_t)std::lround(std::clamp(_c, 0.f, 255.f) * _max / 255.f);
+  };
+  return (uint16_t)(quantize(_color.x, 31) << 11 | quantize(_color.y, 63) << 5 |
+                    quantize(_color.z, 31));
+}
+
+static glm::vec3
+fromRgb565(uint16_t _color) {
+  // as decoded by the GPU, replicating the high bits into the low ones
+  int r = (_color >> 11) & 31;
+  int g = (_color >> 5) & 63;
+  int b = _color & 31;
+  return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Encode the RGB of a block in 8 bytes: 2 RGB565 endpoints, then a 2
+/// bit index per texel into the endpoints and 2 colors between them
+static void
+encodeColorBlock(const Block& _block, vector<unsigned char>& _out) {
+  // Endpoints at the extremes of the colors along their principal axis
+  glm::vec3 colors[16];
+  glm::vec3 mean(0, 0, 0);
+  for (int i = 0; i < 16; i++) {
+    colors[i] = glm::vec3(_block[i][0], _block[i][1], _block[i][2]);
+    mean += colors[i] / 16.f;
+  }
+  float xx = 0, xy = 0, xz = 0, yy = 0, yz = 0, zz = 0;
+  for (const glm::vec3& color : colors) {
+    glm::vec3 d = color - mean;
+    xx += d.x * d.x; xy += d.x * d.y; xz += d.x * d.z;
+    yy += d.y * d.y; yz += d.y * d.z; zz += d.z * d.z;
+  }
+  glm::vec3 axis(1, 1, 1);
+  for (int i = 0; i < 8; i++) {
+    // power iteration on the covariance matrix
+    axis = glm::vec3(xx * axis.x + xy * axis.y + xz * axis.z,
+                     xy * axis.x + yy * axis.y + yz * axis.z,
+                     xz * axis.x + yz * axis.y + zz * axis.z);
+    float length = glm::length(axis);
+    if (length < 1e-6f) {
+      // all texels have the same color
+      axis = glm::vec3(0, 0, 0);
+      break;
+    }
+    axis /= length;
+  }
+  float minT = 0, maxT = 0;
+  for (const glm::vec3& color : colors) {
+    float t = glm::dot(color - mean, axis);
+    minT = std::min(minT, t);
+    maxT = std::max(maxT, t);
+  }
+  uint16_t c0 = toRgb565(mean + axis * maxT);
+  uint16_t c1 = toRgb565(mean + axis * minT);
+  // c0 > c1 selects the 4 color mode
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+
+  uint32_t indices = 0;
+  if (c0 != c1) {
+    glm::vec3 palette[4];
+    palette[0] = fromRgb565(c0);
+    palette[1] = fromRgb565(c1);
+    palette[2] = (2.f * palette[0] + palette[1]) / 3.f;
+    palette[3] = (palette[0] + 2.f * palette[1]) / 3.f;
+    for (int i = 0; i < 16; i++) {
+      int best = 0;
+      float bestDistance = INFINITY;
+      for (int p = 0; p < 4; p++) {
+        glm::vec3 d = colors[i] - palette[p];
+        float distance = glm::dot(d, d);
+        if (distance < bestDistance) {
+          best = p;
+          bestDistance = distance;
+        }
+      }
+      indices |= (uint32_t)best << (2 * i);
+    }
+  }
+  appendLittleEndian(_out, c0, 2);
+  appendLittleEndian(_out, c1, 2);
+  appendLittleEndian(_out, indices, 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Encode one channel of a block in 8 bytes: 2 8-bit endpoints, then a
+/// 3 bit index per texel into the endpoints and 6 values between them
+static void
+encodeChannelBlock(const Block& _block, int _channel, vector<unsigned char>& _out) {
+  int a0 = 0, a1 = 255;
+  for (int i = 0; i < 16; i++) {
+    a0 = std::max(a0, (int)_block[i][_channel]);
+    a1 = std::min(a1, (int)_block[i][_channel]);
+  }
+  // a0 > a1 selects the 8 value mode
+  uint64_t indices = 0;
+  if (a0 != a1) {
+    float palette[8] = {(float)a0, (float)a1};
+    for (int p = 2; p < 8; p++) {
+      palette[p] = ((8 - p) * a0 + (p - 1) * a1) / 7.f;
+    }
+    for (int i = 0; i < 16; i++) {
+      int best = 0;
+      for (int p = 1; p < 8; p++) {
+        if (std::abs(_block[i][_channel] - palette[p])
+            < std::abs(_block[i][_channel] - palette[best])) {
+          best = p;
+        }
+      }
+      indices |= (uint64_t)best << (3 * i);
+    }
+  }
+  _out.push_back((unsigned char)a0);
+  _out.push_back((unsigned char)a1);
+  appendLittleEndian(_out, indices, 6);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Encode all blocks of an image, row of blocks by row of blocks
+template<typename EncodeBlock>
+static vector<unsigned char>
+encodeBlocks(const unsigned char* _rgba, int _width, int _height,
+             size_t _blockSize, EncodeBlock _encodeBlock) {
+  int blocksX = (_width + 3) / 4;
+  int blocksY = (_height + 3) / 4;
+  vector<unsigned char> out;
+  out.reserve(_blockSize * blocksX * blocksY);
+  Block block;
+  for (int by = 0; by < blocksY; by++) {
+    for (int bx = 0; bx < blocksX; bx++) {
+      loadBlock(_rgba, _width, _height, bx, by, block);
+      _encodeBlock(block, out);
+    }
+  }
+  return out;
+}
+
+vector<unsigned char>
+encodeBc1(const unsigned char* _rgba, int _width, int _height) {
+  return encodeBlocks(_rgba, _width, _height, 8,
+      [](const Block& _block, vector<unsigned char>& _out) {
+        encodeColorBlock(_block, _out);
+      });
+}
+
+vector<unsigned char>
+encodeBc3(const unsigned char* _rgba, int _width, int _height) {
+  return encodeBlocks(_rgba, _width, _height, 16,
+      [](const Block& _block, vector<unsigned char>& _out) {
+        encodeChannelBlock(_block, 3, _out);
+        encodeColorBlock(_block, _out);
+      });
+}
+
+vector<unsigned char>
+encodeBc5(const unsigned char* _rgba, int _width, int _height) {
+  return encodeBlocks(_rgba, _width, _height, 16,
+      [](const Block& _block, vector<unsigned char>& _out) {
+        encodeChannelBlock(_block, 0, _out);
+        encodeChannelBlock(_block, 1, _out);
+      });
+}
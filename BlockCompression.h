@@ -0,0 +1,29 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief CPU encoders of the block compressed texture formats sampled by the
+///        GPU without decompression. Each 4x4 texel block is encoded on its
+///        own, texels past the image edges repeat the last row or column.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef BLOCK_COMPRESSION_H_
+#define BLOCK_COMPRESSION_H_
+
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Encode RGB into BC1 (DXT1), 8 bytes per block. Alpha is ignored.
+/// @param _rgba Texels of 4 bytes, rows in the order they are uploaded
+std::vector<unsigned char> encodeBc1(const unsigned char* _rgba,
+                                     int _width, int _height);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Encode RGBA into BC3 (DXT5), 16 bytes per block
+std::vector<unsigned char> encodeBc3(const unsigned char* _rgba,
+                                     int _width, int _height);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Encode red and green into BC5 (RGTC2), 16 bytes per block. Meant for
+/// normal maps, whose z is rebuilt from x and y when sampled.
+std::vector<unsigned char> encodeBc5(const unsigned char* _rgba,
+                                     int _width, int _height);
+
+#endif // BLOCK_COMPRESSION_H_
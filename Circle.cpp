@@ -8,7 +8,8 @@ RayHit
 Circle::
 intersectRay(Ray _ray) const {
   RayHit hit = Plane::intersectRay(_ray);
-  if(glm::length2(hit.position - m_center) < m_radiusSq) {
+  glm::vec3 hitPos = _ray.getOrigin() + _ray.getDirection() * hit.t;
+  if(glm::length2(hitPos - m_center) < m_radiusSq) {
     return hit; // collides within the circle
   }
   return RayHit(); // no collision
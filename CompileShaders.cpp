@@ -1,23 +1,71 @@
 #include "CompileShaders.h"
 
 // STL
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
+#include <vector>
 using namespace std;
 
+/// Directory of cached program binaries
+static const string g_binaryCacheDir = "shader_cache";
+
 string
 parseShader(const string& _shader) {
   ifstream ifs(_shader);
+  if(!ifs) {
+    cerr << "Error opening shader '" << _shader << "'" << endl;
+    exit(1);
+  }
+  // directory of the shader, to resolve included files
+  size_t slash = _shader.find_last_of('/');
+  string dir = slash == string::npos ? "" : _shader.substr(0, slash + 1);
+
   ostringstream oss;
-  oss << ifs.rdbuf();
+  string line;
+  while(getline(ifs, line)) {
+    // replace lines of format: #include "file" with content of file
+    size_t open = line.find('"');
+    size_t close = line.rfind('"');
+    if(line.compare(0, 8, "#include") == 0 && open < close) {
+      oss << parseShader(dir + line.substr(open + 1, close - open - 1));
+    } else {
+      oss << line << '\n';
+    }
+  }
   return oss.str();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Insert #define lines after the #version line, which must stay first
+string
+injectDefines(const string& _source, const vector<string>& _defines) {
+  if (_defines.empty()) {
+    return _source;
+  }
+  ostringstream oss;
+  for (auto& define : _defines) {
+    oss << "#define " << define << '\n';
+  }
+  size_t version = _source.find("#version");
+  if (version == string::npos) {
+    return oss.str() + _source;
+  }
+  size_t lineEnd = _source.find('\n', version);
+  if (lineEnd == string::npos) {
+    return _source + '\n' + oss.str();
+  }
+  return _source.substr(0, lineEnd + 1) + oss.str() + _source.substr(lineEnd + 1);
+}
+
 GLuint
-compileSingleShader(const string& shaderFile, GLenum shaderType, char* infoLog) {
-  string shaderFromFile = parseShader(shaderFile);
-  const char* prog = shaderFromFile.c_str();
+compileSingleShader(const string& shaderFile, const string& source,
+                    GLenum shaderType, char* infoLog) {
+  const char* prog = source.c_str();
 
   GLuint shader = glCreateShader(shaderType);
   glShaderSource(shader, 1, &prog, NULL);
@@ -34,22 +82,152 @@ compileSingleShader(const string& shaderFile, GLenum shaderType, char* infoLog)
   return shader;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// 64-bit FNV-1a hash, stable across runs and builds unlike std::hash
+uint64_t
+hashString(const string& _str, uint64_t _hash = 14695981039346656037ull) {
+  for (unsigned char c : _str) {
+    _hash = (_hash ^ c) * 1099511628211ull;
+  }
+  return _hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Whether the driver can save and load program binaries. They are core from
+/// GL 4.1 only, and an optional extension of the 3.3 context used here.
+bool
+hasProgramBinaries() {
+  static int hasBinaries = -1;
+  if (hasBinaries >= 0) {
+    return hasBinaries;
+  }
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  bool isSupported = major > 4 || (major == 4 && minor >= 1);
+  GLint nExtensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &nExtensions);
+  for (GLint i = 0; i < nExtensions && !isSupported; i++) {
+    const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+    if (extension &&
+        strcmp((const char*)extension, "GL_ARB_get_program_binary") == 0) {
+      isSupported = true;
+    }
+  }
+  // drivers may support the functions without any binary format
+  GLint nFormats = 0;
+  if (isSupported) {
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+  }
+  hasBinaries = nFormats > 0;
+  return hasBinaries;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// File caching the binary of a program, keyed by its full sources and the
+/// driver that compiled it
+/// @return Path of the file, empty if binaries can't be cached
+string
+getBinaryCacheFile(const string& _vertexSource, const string& _fragmentSource) {
+  if (!hasProgramBinaries()) {
+    return "";
+  }
+  string driver;
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const GLubyte* str = glGetString(name);
+    driver += str ? (const char*)str : "";
+    driver += '\n';
+  }
+  uint64_t hash = hashString(driver);
+  hash = hashString(_vertexSource, hash);
+  hash = hashString(string(1, '\0'), hash);
+  hash = hashString(_fragmentSource, hash);
+  ostringstream oss;
+  oss << g_binaryCacheDir << '/' << hex << hash << ".bin";
+  return oss.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Create a program from a cached binary
+/// @return Program, 0 if there is no valid binary in the file
+GLuint
+loadProgramBinary(const string& _file) {
+  ifstream ifs(_file, ios::binary);
+  if (!ifs) {
+    return 0;
+  }
+  GLenum format;
+  if (!ifs.read((char*)&format, sizeof(format))) {
+    return 0;
+  }
+  vector<char> binary{istreambuf_iterator<char>(ifs), istreambuf_iterator<char>()};
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, format, binary.data(), binary.size());
+  // driver rejects binaries it can't use, e.g. after an update
+  GLint success;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the binary of a linked program to the cache, ignoring failures
+void
+saveProgramBinary(GLuint _program, const string& _file) {
+  GLint length = 0;
+  glGetProgramiv(_program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  vector<char> binary(length);
+  GLenum format;
+  glGetProgramBinary(_program, length, nullptr, &format, binary.data());
+  error_code error;
+  filesystem::create_directories(g_binaryCacheDir, error);
+  ofstream ofs(_file, ios::binary);
+  ofs.write((const char*)&format, sizeof(format));
+  ofs.write(binary.data(), binary.size());
+  if (!ofs) {
+    cerr << "Could not cache program binary '" << _file << "'" << endl;
+  }
+}
+
 GLuint
 compileProgram(const string& _vertexShader,
-               const string& _fragmentShader) {
+               const string& _fragmentShader,
+               const vector<string>& _defines) {
+  string vertexSource = injectDefines(parseShader(_vertexShader), _defines);
+  string fragmentSource = injectDefines(parseShader(_fragmentShader), _defines);
+
+  // Use the binary of a previous run if possible
+  string cacheFile = getBinaryCacheFile(vertexSource, fragmentSource);
+  if (!cacheFile.empty()) {
+    GLuint program = loadProgramBinary(cacheFile);
+    if (program != 0) {
+      return program;
+    }
+  }
+
   int success;
   char infoLog[512];
 
   // Compile each single shader
   GLuint vertexShader = compileSingleShader(
-      _vertexShader, GL_VERTEX_SHADER, infoLog);
+      _vertexShader, vertexSource, GL_VERTEX_SHADER, infoLog);
   GLuint fragmentShader = compileSingleShader(
-      _fragmentShader, GL_FRAGMENT_SHADER, infoLog);
+      _fragmentShader, fragmentSource, GL_FRAGMENT_SHADER, infoLog);
 
   // Link the shaders into a shader program
   GLuint shaderProgram = glCreateProgram();
   glAttachShader(shaderProgram, vertexShader);
   glAttachShader(shaderProgram, fragmentShader);
+  if (!cacheFile.empty()) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 
+                        GL_TRUE);
+  }
   glLinkProgram(shaderProgram);
 
   glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
@@ -63,5 +241,39 @@ compileProgram(const string& _vertexShader,
   glDeleteShader(vertexShader);
   glDeleteShader(fragmentShader);
 
+  if (!cacheFile.empty()) {
+    saveProgramBinary(shaderProgram, cacheFile);
+  }
   return shaderProgram;
 }
+
+ProgramCache::
+ProgramCache(const string& _vertexShader,
+             const string& _fragmentShader,
+             function<void(GLuint)> _setup)
+  : m_vertexShader(_vertexShader),
+    m_fragmentShader(_fragmentShader),
+    m_setup(move(_setup))
+{}
+
+ProgramCache::
+~ProgramCache() {
+  for (auto& entry : m_programs) {
+    glDeleteProgram(entry.second);
+  }
+}
+
+GLuint
+ProgramCache::
+get(const vector<string>& _defines) {
+  auto it = m_programs.find(_defines);
+  if (it != m_programs.end()) {
+    return it->second;
+  }
+  GLuint program = compileProgram(m_vertexShader, m_fragmentShader, _defines);
+  m_programs.emplace(_defines, program);
+  if (m_setup) {
+    m_setup(program);
+  }
+  return program;
+}
\ No newline at end of file
@@ -6,7 +6,10 @@
 #define COMPILE_SHADERS_H_
 
 // STL
+#include <functional>
+#include <map>
 #include <string>
+#include <vector>
 
 // GL
 #include "GLInclude.h"
@@ -14,11 +17,55 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief Compile a vertex shader and fragment shader together
+///
+/// Shaders may contain lines of the form #include "file", which are replaced
+/// with the content of the file, relative to the including shader.
+///
+/// If the driver supports program binaries, linked programs are cached in
+/// shader_cache/, keyed by their sources and the driver. Later calls with the
+/// same sources load the binary instead, falling back to compiling if the
+/// driver rejects it.
 /// @param _vertexShader   Filename of vertex shader
 /// @param _fragmentShader Filename of fragment shader
+/// @param _defines        Macros defined in both shaders, right after their
+///                        #version line, as "NAME" or "NAME value"
 /// @return GL program identifier
 GLuint compileProgram(const std::string& _vertexShader,
-                      const std::string& _fragmentShader);
+                      const std::string& _fragmentShader,
+                      const std::vector<std::string>& _defines = {});
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Permutations of a program, each compiled with its own set of
+/// defines on first use
+class ProgramCache
+{
+  public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @param _vertexShader   Filename of vertex shader
+    /// @param _fragmentShader Filename of fragment shader
+    /// @param _setup          Called once on each newly compiled program, e.g.
+    ///                        to bind its uniform blocks
+    ProgramCache(const std::string& _vertexShader,
+                 const std::string& _fragmentShader,
+                 std::function<void(GLuint)> _setup = nullptr);
+
+    ~ProgramCache();
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Program compiled with the defines, see compileProgram
+    GLuint get(const std::vector<std::string>& _defines);
+
+    /// Number of compiled permutations
+    size_t size() const { return m_programs.size(); }
+
+  private:
+    std::string m_vertexShader;
+    std::string m_fragmentShader;
+    std::function<void(GLuint)> m_setup;
+    std::map<std::vector<std::string>, GLuint> m_programs;
+};
 
 
 #endif // COMPILE_SHADERS_H_
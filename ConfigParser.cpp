@@ -19,5 +19,28 @@ parse(const std::string& _configFileName) {
   config.screenWidth = j.at("screen_size").at(0).get<int>();
   config.screenHeight = j.at("screen_size").at(1).get<int>();
   config.sceneFile = j.at("scene").get<std::string>();
+  // optional settings
+  if (j.find("compact_vertices") != j.end()) {
+    config.compactVertices = j.at("compact_vertices").get<bool>();
+  }
+  if (j.find("depth_prepass") != j.end()) {
+    config.depthPrepass = j.at("depth_prepass").get<bool>();
+  }
+  if (j.find("order_independent_transparency") != j.end()) {
+    config.orderIndependentTransparency = 
+        j.at("order_independent_transparency").get<bool>();
+  }
+  if (j.find("linear_textures") != j.end()) {
+    config.linearTextures = j.at("linear_textures").get<bool>();
+  }
+  if (j.find("texture_streaming") != j.end()) {
+    config.textureStreaming = j.at("texture_streaming").get<bool>();
+  }
+  if (j.find("texture_arrays") != j.end()) {
+    config.textureArrays = j.at("texture_arrays").get<bool>();
+  }
+  if (j.find("compressed_textures") != j.end()) {
+    config.compressedTextures = j.at("compressed_textures").get<bool>();
+  }
   return config;
 }
\ No newline at end of file
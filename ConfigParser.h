@@ -9,6 +9,18 @@ struct Config {
   int screenWidth;
   int screenHeight;
   std::string sceneFile;
+  bool compactVertices = false; ///< Rasterizer uses quantized vertices
+  bool depthPrepass = false;    ///< Rasterizer renders a depth pre-pass
+  /// Rasterizer blends transparency without sorting
+  bool orderIndependentTransparency = false;
+  /// Ray tracer decodes textures to linear floats, and shades in linear space
+  bool linearTextures = false;
+  /// Rasterizer loads textures in the background, starting from placeholders
+  bool textureStreaming = false;
+  /// Rasterizer packs textures of the same size into texture arrays
+  bool textureArrays = false;
+  /// Rasterizer uploads textures as compressed blocks, cached next to them
+  bool compressedTextures = false;
 };
 
 class ConfigParser
@@ -14,12 +14,14 @@ getLightRay(glm::vec3 _destination) const {
   };
 }
 
-void 
+LightData
 DirectionalLight::
-sendLightData(LightUniformLocations locations) const {
-  glUniform1i(locations.type, 3); // type 3 is directional light
-  glUniform3fv(locations.dir, 1, glm::value_ptr(m_dir));
-  glUniform3fv(locations.intensityAmbient,  1, glm::value_ptr(m_intensityAmbient));
-  glUniform3fv(locations.intensityDiffuse,  1, glm::value_ptr(m_intensityDiffuse));
-  glUniform3fv(locations.intensitySpecular, 1, glm::value_ptr(m_intensitySpecular));
+getLightData() const {
+  LightData data{};
+  data.type = 3; // type 3 is directional light
+  data.dir = m_dir;
+  data.ia = m_intensityAmbient;
+  data.id = m_intensityDiffuse;
+  data.is = m_intensitySpecular;
+  return data;
 }
\ No newline at end of file
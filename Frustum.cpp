@@ -0,0 +1,55 @@
+#include "Frustum.h"
+
+using glm::vec3, glm::vec4;
+
+Frustum::
+Frustum(const glm::mat4& _viewProjection) {
+  // rows of the matrix, glm is column major
+  vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] = vec4(_viewProjection[0][i], _viewProjection[1][i],
+                   _viewProjection[2][i], _viewProjection[3][i]);
+  }
+  // clip space point is inside if -w <= x, y, z <= w
+  m_planes = {
+    rows[3] + rows[0], rows[3] - rows[0], // left, right
+    rows[3] + rows[1], rows[3] - rows[1], // bottom, top
+    rows[3] + rows[2], rows[3] - rows[2], // near, far
+  };
+  // normalize so that plane distances are in world units
+  for (auto& plane : m_planes) {
+    plane /= glm::length(vec3(plane));
+  }
+}
+
+bool
+Frustum::
+intersects(const BoundingSphere& _sphere) const {
+  for (auto& plane : m_planes) {
+    if (glm::dot(vec3(plane), _sphere.center) + plane.w < -_sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+Frustum::
+cull(const BoundingSphereArray& _spheres,
+     std::vector<uint8_t>& _visible) const {
+  size_t n = _spheres.size();
+  _visible.assign(n, 1);
+  const float* x = _spheres.x.data();
+  const float* y = _spheres.y.data();
+  const float* z = _spheres.z.data();
+  const float* r = _spheres.radius.data();
+  uint8_t* visible = _visible.data();
+  // one pass per plane over flat arrays without branches, so the compiler
+  // can vectorize the inner loop
+  for (auto& plane : m_planes) {
+    float a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+    for (size_t i = 0; i < n; i++) {
+      visible[i] &= (uint8_t)(a * x[i] + b * y[i] + c * z[i] + d >= -r[i]);
+    }
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Bounding spheres of many objects, stored as separate arrays per
+/// component so that they can be tested against planes in SIMD batches
+////////////////////////////////////////////////////////////////////////////////
+struct BoundingSphereArray {
+  std::vector<float> x, y, z; ///< Centers
+  std::vector<float> radius;
+
+  size_t size() const { return radius.size(); }
+
+  void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+
+  void push_back(const BoundingSphere& _sphere) {
+    x.push_back(_sphere.center.x);
+    y.push_back(_sphere.center.y);
+    z.push_back(_sphere.center.z);
+    radius.push_back(_sphere.radius);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief View frustum as 6 planes in world space, pointing inward
+////////////////////////////////////////////////////////////////////////////////
+class Frustum
+{
+  public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Extract the frustum planes from a view-projection matrix
+    /// @param _viewProjection Transform from world to clip space
+    explicit Frustum(const glm::mat4& _viewProjection);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Whether the sphere is at least partly inside the frustum
+    bool intersects(const BoundingSphere& _sphere) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Test many spheres at once. Conservative like intersects: some
+    /// spheres outside the frustum near its corners are kept.
+    /// @param _spheres Spheres to test
+    /// @param _visible Output, 1 for each sphere that may be visible, 0 for
+    ///                 spheres entirely outside
+    void cull(const BoundingSphereArray& _spheres,
+              std::vector<uint8_t>& _visible) const;
+
+  private:
+    /// Planes as (normal, distance), a point p is inside if
+    /// dot(normal, p) + distance >= 0
+    std::array<glm::vec4, 6> m_planes;
+};
+
+#endif // FRUSTUM_H_
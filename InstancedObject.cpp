@@ -0,0 +1,151 @@
+#include "InstancedObject.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+using glm::mat4, glm::vec3, glm::vec4;
+
+InstancedObject::
+InstancedObject(std::shared_ptr<const Mesh> _mesh,
+                const MaterialConfig& _materialConfig,
+                const std::vector<mat4>& _transforms)
+  : RasterizableObject(std::move(_mesh), _materialConfig, mat4(1.f)),
+    m_modelBounds(computeBoundingSphere(*m_mesh)),
+    m_roughPosition(0, 0, 0),
+    m_instanceVbo(0)
+{
+  m_instances.reserve(_transforms.size());
+  m_inverseModels.reserve(_transforms.size());
+  for (auto& transform : _transforms) {
+    mat4 inverse = glm::inverse(transform);
+    m_instances.push_back({transform, glm::transpose(inverse)});
+    m_inverseModels.push_back(inverse);
+    m_roughPosition += vec3(transform[3]);
+  }
+  if (!_transforms.empty()) {
+    m_roughPosition /= (float)_transforms.size();
+  }
+
+  // world bounds enclose the bounds of all instances, around their average
+  m_worldBounds = {m_roughPosition, 0};
+  for (auto& transform : _transforms) {
+    BoundingSphere bounds = m_modelBounds.transformed(transform);
+    m_worldBounds.radius = std::max(m_worldBounds.radius, 
+        glm::length(bounds.center - m_roughPosition) + bounds.radius);
+  }
+}
+
+void
+InstancedObject::
+sendMeshData(bool _isCompact) {
+  // create the vertex array with the mesh attributes
+  RasterizableObject::sendMeshData(_isCompact);
+
+  // add the per-instance matrices to it
+  glBindVertexArray(m_vao);
+  glGenBuffers(1, &m_instanceVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+  glBufferData(GL_ARRAY_BUFFER,
+               sizeof(InstanceMatrices) * m_instances.size(),
+               m_instances.data(),
+               GL_STATIC_DRAW);
+  // a mat4 attribute takes 4 locations, one per column
+  // - vertex model matrix, locations 4-7
+  // - normal model matrix, locations 8-11
+  for (int i = 0; i < 4; i++) {
+    GLuint vertexLoc = 4 + i;
+    glEnableVertexAttribArray(vertexLoc);
+    glVertexAttribPointer(vertexLoc, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(InstanceMatrices),
+                          (void*)(offsetof(InstanceMatrices, vertexModel)
+                                  + sizeof(vec4) * i));
+    glVertexAttribDivisor(vertexLoc, 1);
+    GLuint normalLoc = 8 + i;
+    glEnableVertexAttribArray(normalLoc);
+    glVertexAttribPointer(normalLoc, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(InstanceMatrices),
+                          (void*)(offsetof(InstanceMatrices, normalModel)
+                                  + sizeof(vec4) * i));
+    glVertexAttribDivisor(normalLoc, 1);
+  }
+
+  // Unbind
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+ObjectData
+InstancedObject::
+getObjectData() const {
+  // model matrices come from the instance buffer instead
+  ObjectData data = RasterizableObject::getObjectData();
+  data.flags |= FLAG_INSTANCES;
+  return data;
+}
+
+void
+InstancedObject::
+draw(RenderStateCache& _state) {
+  // set the object uniform data
+  bindObjectData(_state);
+  // draw
+  _state.bindVertexArray(m_vao);
+  glDrawArraysInstanced(GL_TRIANGLES, 0, m_nVertices, m_instances.size());
+}
+
+RayHit
+InstancedObject::
+intersectRay(Ray _ray) const {
+  RayHit closestHit;
+  closestHit.t = std::numeric_limits<float>::infinity();
+  bool isHit = false;
+  vec3 origin = _ray.getOrigin();
+  for (size_t i = 0; i < m_instances.size(); i++) {
+    // transform the ray into model space of the instance
+    Ray modelRay = _ray.transformed(m_inverseModels[i]);
+    // skip the instance if the ray misses its bounding sphere
+    vec3 toCenter = m_modelBounds.center - modelRay.getOrigin();
+    float tCenter = glm::dot(toCenter, modelRay.getDirection());
+    float distSq = glm::dot(toCenter, toCenter) - tCenter * tCenter;
+    if (distSq > m_modelBounds.radius * m_modelBounds.radius) {
+      continue;
+    }
+
+    RayHit hit;
+    hit.t = std::numeric_limits<float>::infinity();
+    if (!intersectModelMesh(modelRay, &hit)) {
+      continue;
+    }
+    // convert hit back to world space, where distance along the ray differs
+    // from model space if the instance is scaled
+    vec3 modelPos = modelRay.getOrigin() + modelRay.getDirection() * hit.t;
+    vec3 position = vec3(m_instances[i].vertexModel * vec4(modelPos, 1));
+    hit.t = glm::length(position - origin);
+    if (hit.t < closestHit.t) {
+      closestHit = hit;
+      // the primitive indexes the vertices of all instances one after another
+      closestHit.primitive += i * m_nVertices;
+      isHit = true;
+    }
+  }
+  if (!isHit) return RayHit();
+  closestHit.object = this;
+  return closestHit;
+}
+
+SurfaceHit
+InstancedObject::
+surfaceAt(const Ray& _ray, const RayHit& _hit) const {
+  size_t instance = _hit.primitive / m_nVertices;
+  size_t first = _hit.primitive % m_nVertices;
+  const std::vector<Vertex>& vertices = m_mesh->vertices;
+  SurfaceHit hit = surfaceAtTriangle(_ray.transformed(m_inverseModels[instance]),
+                                     _hit.barycentric, vertices[first],
+                                     vertices[first + 1], vertices[first + 2]);
+  // convert surface back to world space
+  const InstanceMatrices& matrices = m_instances[instance];
+  hit.position = vec3(matrices.vertexModel * vec4(hit.position, 1));
+  hit.normal = glm::normalize(vec3(matrices.normalModel * vec4(hit.normal, 0)));
+  return hit;
+}
@@ -0,0 +1,61 @@
+#ifndef INSTANCED_OBJECT_H_
+#define INSTANCED_OBJECT_H_
+
+#include <memory>
+#include <vector>
+
+#include "RasterizableObject.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// A mesh placed many times in the scene with different transforms, while
+/// storing the mesh only once.
+///
+/// The rasterizer draws all instances in a single instanced draw call, reading
+/// the model matrices from a per-instance vertex buffer. The ray tracer
+/// transforms each ray into the model space of every instance, and skips
+/// instances whose bounding sphere the ray misses.
+class InstancedObject : public RasterizableObject
+{
+  public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Create instances of a mesh
+    /// @param _mesh           Mesh shared by all instances, in model space
+    /// @param _materialConfig Material shared by all instances
+    /// @param _transforms     Model matrix of each instance
+    InstancedObject(std::shared_ptr<const Mesh> _mesh,
+                    const MaterialConfig& _materialConfig,
+                    const std::vector<glm::mat4>& _transforms);
+
+    void sendMeshData(bool _isCompact) override;
+
+    bool isBatchable() const override { return false; }
+
+    void draw(RenderStateCache& _state) override;
+
+    ObjectData getObjectData() const override;
+
+    RayHit intersectRay(Ray _ray) const override;
+
+    SurfaceHit surfaceAt(const Ray& _ray, const RayHit& _hit) const override;
+
+    glm::vec3 getRoughPosition() const override { return m_roughPosition; };
+
+  private:
+    /// Matrices of one instance, uploaded as is to the instance buffer
+    struct InstanceMatrices {
+      glm::mat4 vertexModel; ///< Transform vertex from model to world
+      glm::mat4 normalModel; ///< Transform normal from model to world
+    };
+
+    std::vector<InstanceMatrices> m_instances;
+    /// Transform from world to model space of each instance, for ray tracing
+    std::vector<glm::mat4> m_inverseModels;
+    /// Bounding sphere of the mesh in model space
+    BoundingSphere m_modelBounds;
+    /// Average position of the instances
+    glm::vec3 m_roughPosition;
+    /// Name of the buffer storing per-instance matrices
+    GLuint m_instanceVbo;
+};
+
+#endif // INSTANCED_OBJECT_H_
@@ -0,0 +1,247 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// GLM length2 function
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/norm.hpp>
+
+using glm::mat4, glm::vec3, glm::vec4;
+
+const float LightClusters::CUTOFF_INTENSITY = 1.f / 256;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Distance from a light where its attenuation brings it under the cutoff
+/// @return Range of the light, infinite if it is not attenuated
+float
+getLightRange(const LightData& _light, float _cutoff) {
+  if (_light.type == 3) {
+    // directional light
+    return std::numeric_limits<float>::infinity();
+  }
+  vec3 maxIntensity = glm::max(_light.id, _light.is);
+  float intensity = std::max({maxIntensity.x, maxIntensity.y, maxIntensity.z});
+  // solve a0 + a1*d + a2*d^2 = intensity / cutoff
+  float target = intensity / _cutoff;
+  const vec3& a = _light.al;
+  if (target <= a[0]) {
+    return 0;
+  }
+  if (a[2] > 0) {
+    return (-a[1] + std::sqrt(a[1]*a[1] + 4*a[2]*(target - a[0]))) / (2*a[2]);
+  }
+  if (a[1] > 0) {
+    return (target - a[0]) / a[1];
+  }
+  return std::numeric_limits<float>::infinity();
+}
+
+LightClusters::
+LightClusters()
+  : m_projection(0.f),
+    m_isPerspective(true),
+    m_depthScale(0),
+    m_depthBias(0),
+    m_clusterLights(N_CLUSTERS),
+    m_clusters(2 * N_CLUSTERS, 0)
+{
+  const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R16UI};
+  glGenBuffers(3, m_buffers);
+  glGenTextures(3, m_textures);
+  for (int i = 0; i < 3; i++) {
+    // start with a small buffer, texture buffers can't be empty
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[i]);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(LightData), nullptr, GL_DYNAMIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+    glTexBuffer(GL_TEXTURE_BUFFER, formats[i], m_buffers[i]);
+  }
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightClusters::
+~LightClusters() {
+  glDeleteTextures(3, m_textures);
+  glDeleteBuffers(3, m_buffers);
+}
+
+void
+LightClusters::
+setLights(const std::vector<LightData>& _lights, FrameData& _frame) {
+  // lights reaching everything go first in the buffer
+  std::vector<LightData> sorted;
+  std::vector<LightData> bounded;
+  m_lightSpheres.clear();
+  m_lightIndices.clear();
+  _frame.ambientIntensity = vec3(0, 0, 0);
+  for (auto& light : _lights) {
+    _frame.ambientIntensity += light.ia;
+    float range = getLightRange(light, CUTOFF_INTENSITY);
+    if (std::isinf(range)) {
+      sorted.push_back(light);
+    } else {
+      bounded.push_back(light);
+      m_lightSpheres.emplace_back(light.pos, range);
+    }
+  }
+  _frame.numGlobalLights = sorted.size();
+  for (size_t i = 0; i < bounded.size(); i++) {
+    m_lightIndices.push_back(sorted.size() + i);
+  }
+  sorted.insert(sorted.end(), bounded.begin(), bounded.end());
+
+  if (!sorted.empty()) {
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[0]);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(LightData) * sorted.size(), 
+                 sorted.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+}
+
+int
+LightClusters::
+getSlice(float _depth) const {
+  if (m_isPerspective) {
+    if (_depth <= 0) return -1;
+    _depth = std::log(_depth);
+  }
+  // clamp before converting, far depths may not fit an int
+  float slice = glm::clamp(std::floor(_depth * m_depthScale - m_depthBias), 
+                           -1.f, (float)DEPTH_SLICES);
+  return (int)slice;
+}
+
+void
+LightClusters::
+computeClusterBoxes(const mat4& _projection) {
+  m_projection = _projection;
+  // near and far planes from the projection
+  float near, far;
+  m_isPerspective = _projection[3][3] == 0;
+  if (m_isPerspective) {
+    near = _projection[3][2] / (_projection[2][2] - 1);
+    far = _projection[3][2] / (_projection[2][2] + 1);
+    m_depthScale = DEPTH_SLICES / std::log(far / near);
+    m_depthBias = std::log(near) * m_depthScale;
+  } else {
+    near = (_projection[3][2] + 1) / _projection[2][2];
+    far = (_projection[3][2] - 1) / _projection[2][2];
+    m_depthScale = DEPTH_SLICES / (far - near);
+    m_depthBias = near * m_depthScale;
+  }
+  // depth of the boundaries between slices
+  std::vector<float> sliceDepths(DEPTH_SLICES + 1);
+  for (int k = 0; k <= DEPTH_SLICES; k++) {
+    float f = (float)k / DEPTH_SLICES;
+    sliceDepths[k] = m_isPerspective ? near * std::pow(far / near, f) 
+                                     : near + (far - near) * f;
+  }
+
+  // a cluster is bounded by the 4 lines through its tile corners, cut at the
+  // depths of its slice
+  mat4 inverse = glm::inverse(_projection);
+  auto unproject = [&](float x, float y, float z) {
+    vec4 p = inverse * vec4(x, y, z, 1);
+    return vec3(p) / p.w;
+  };
+  m_clusterBoxes.resize(N_CLUSTERS);
+  for (int y = 0; y < TILES_Y; y++) {
+    for (int x = 0; x < TILES_X; x++) {
+      vec3 nearCorners[4], farCorners[4];
+      for (int c = 0; c < 4; c++) {
+        float ndcX = -1 + 2.f * (x + c % 2) / TILES_X;
+        float ndcY = -1 + 2.f * (y + c / 2) / TILES_Y;
+        nearCorners[c] = unproject(ndcX, ndcY, -1);
+        farCorners[c] = unproject(ndcX, ndcY, 1);
+      }
+      for (int k = 0; k < DEPTH_SLICES; k++) {
+        Box box{vec3(std::numeric_limits<float>::max()), 
+                vec3(std::numeric_limits<float>::lowest())};
+        for (int c = 0; c < 4; c++) {
+          vec3 dir = farCorners[c] - nearCorners[c];
+          for (int e = 0; e < 2; e++) {
+            // view space z is the negated depth
+            float t = (-sliceDepths[k + e] - nearCorners[c].z) / dir.z;
+            vec3 p = nearCorners[c] + t * dir;
+            box.lo = glm::min(box.lo, p);
+            box.hi = glm::max(box.hi, p);
+          }
+        }
+        m_clusterBoxes[(k * TILES_Y + y) * TILES_X + x] = box;
+      }
+    }
+  }
+}
+
+void
+LightClusters::
+update(const mat4& _view, const mat4& _projection,
+       int _frameWidth, int _frameHeight, FrameData& _frame) {
+  if (_projection != m_projection) {
+    computeClusterBoxes(_projection);
+  }
+  _frame.viewMatrix = _view;
+  _frame.clusterCounts = glm::ivec3(TILES_X, TILES_Y, DEPTH_SLICES);
+  _frame.clusterTileSize = glm::vec2((float)_frameWidth / TILES_X, 
+                                     (float)_frameHeight / TILES_Y);
+  _frame.isClusterDepthLog = m_isPerspective;
+  _frame.clusterDepthScale = m_depthScale;
+  _frame.clusterDepthBias = m_depthBias;
+
+  // list each light in the clusters its sphere overlaps, only looking at the
+  // slices within its depth range
+  for (auto& lights : m_clusterLights) {
+    lights.clear();
+  }
+  for (size_t i = 0; i < m_lightSpheres.size(); i++) {
+    vec3 center = vec3(_view * vec4(vec3(m_lightSpheres[i]), 1));
+    float radius = m_lightSpheres[i].w;
+    float minDepth = -center.z - radius;
+    float maxDepth = -center.z + radius;
+    if (m_isPerspective && maxDepth <= 0) {
+      // entirely behind the camera
+      continue;
+    }
+    int firstSlice = std::max(getSlice(minDepth), 0);
+    int lastSlice = std::min(getSlice(maxDepth), DEPTH_SLICES - 1);
+    for (int k = firstSlice; k <= lastSlice; k++) {
+      for (int c = k * TILES_X * TILES_Y; c < (k + 1) * TILES_X * TILES_Y; c++) {
+        const Box& box = m_clusterBoxes[c];
+        vec3 closest = glm::clamp(center, box.lo, box.hi);
+        if (glm::length2(closest - center) <= radius * radius) {
+          m_clusterLights[c].push_back(m_lightIndices[i]);
+        }
+      }
+    }
+  }
+
+  // flatten the lists
+  m_indices.clear();
+  for (int c = 0; c < N_CLUSTERS; c++) {
+    m_clusters[2 * c] = m_indices.size();
+    m_clusters[2 * c + 1] = m_clusterLights[c].size();
+    m_indices.insert(m_indices.end(), 
+                     m_clusterLights[c].begin(), m_clusterLights[c].end());
+  }
+  if (m_indices.empty()) {
+    m_indices.push_back(0);
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[1]);
+  glBufferData(GL_TEXTURE_BUFFER, sizeof(GLuint) * m_clusters.size(), 
+               m_clusters.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[2]);
+  glBufferData(GL_TEXTURE_BUFFER, sizeof(uint16_t) * m_indices.size(), 
+               m_indices.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void
+LightClusters::
+bind(GLuint _firstUnit) const {
+  for (int i = 0; i < 3; i++) {
+    glActiveTexture(GL_TEXTURE0 + _firstUnit + i);
+    glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+  }
+}
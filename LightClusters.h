@@ -0,0 +1,99 @@
+#ifndef LIGHT_CLUSTERS_H_
+#define LIGHT_CLUSTERS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "GLInclude.h"
+#include "UniformBlocks.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Lights of the scene sorted into clusters of the view frustum, for
+/// clustered forward shading in the rasterizer.
+///
+/// The frustum is split into TILES_X x TILES_Y screen tiles and DEPTH_SLICES
+/// depth slices, exponentially spaced for perspective views. Each frame, the
+/// lights with a bounded range are listed in the clusters their range
+/// reaches, so that a fragment only shades the lights of its cluster. Lights
+/// with an unbounded range (e.g. directional) are shaded everywhere.
+///
+/// Lights, clusters and light lists are uploaded to texture buffers, read by
+/// shaders/lights.glsl.
+class LightClusters
+{
+  public:
+    static const int TILES_X = 16;
+    static const int TILES_Y = 9;
+    static const int DEPTH_SLICES = 24;
+    static const int N_CLUSTERS = TILES_X * TILES_Y * DEPTH_SLICES;
+
+    /// A light is considered out of range once its attenuated intensity falls
+    /// below this, i.e. under one 8-bit color step
+    static const float CUTOFF_INTENSITY;
+
+    LightClusters();
+    ~LightClusters();
+    LightClusters(const LightClusters&) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Upload the lights of the scene and compute their ranges
+    /// @param _lights Lights, at most MAX_LIGHTS
+    /// @param _frame  Frame data receiving the number of global lights and the
+    ///                summed ambient intensity
+    void setLights(const std::vector<LightData>& _lights, FrameData& _frame);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Assign lights to the clusters of the view and upload the lists
+    /// @param _view         View matrix of the camera
+    /// @param _projection   Projection matrix, perspective or orthographic
+    /// @param _frameWidth   Width of the frame, in pixels
+    /// @param _frameHeight  Height of the frame, in pixels
+    /// @param _frame        Frame data receiving the cluster parameters
+    void update(const glm::mat4& _view, const glm::mat4& _projection,
+                int _frameWidth, int _frameHeight, FrameData& _frame);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Bind the light, cluster and light index buffers to 3 texture
+    /// units starting at _firstUnit
+    void bind(GLuint _firstUnit) const;
+
+  private:
+    /// Axis aligned box in view space
+    struct Box {
+      glm::vec3 lo, hi;
+    };
+
+    /// Sphere reached by each bounded light, in world space
+    std::vector<glm::vec4> m_lightSpheres;
+    /// Index in the light buffer of each bounded light
+    std::vector<uint16_t> m_lightIndices;
+
+    /// Bounds of each cluster in view space, for m_projection
+    std::vector<Box> m_clusterBoxes;
+    glm::mat4 m_projection;
+    /// Depth slice of view depth z is f(z)*scale - bias, f is log for
+    /// perspective, identity otherwise
+    bool m_isPerspective;
+    float m_depthScale;
+    float m_depthBias;
+
+    /// Per frame light lists, as (first index, count) per cluster
+    std::vector<std::vector<uint16_t>> m_clusterLights;
+    std::vector<GLuint> m_clusters;
+    std::vector<uint16_t> m_indices;
+
+    /// Texture buffers and their textures: lights, clusters, light indices
+    GLuint m_buffers[3];
+    GLuint m_textures[3];
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Compute bounds of the clusters for a new projection
+    void computeClusterBoxes(const glm::mat4& _projection);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Depth slice of a view depth, possibly out of [0, DEPTH_SLICES)
+    int getSlice(float _depth) const;
+};
+
+#endif // LIGHT_CLUSTERS_H_
@@ -2,20 +2,7 @@
 #define LIGHT_SOURCE_H_
 
 #include "GLInclude.h"
-
-////////////////////////////////////////////////////////////////////////////////
-/// Uniform locations to send light data to rasterizer
-struct LightUniformLocations {
-  GLint type;
-  GLint pos;
-  GLint dir;
-  GLint cutoffDot;
-  GLint intensityAmbient;
-  GLint intensityDiffuse;
-  GLint intensitySpecular;
-  GLint linearAttenuation;
-  GLint angleAttenuation;
-};
+#include "UniformBlocks.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Represent a light ray from a source to a point
@@ -38,8 +25,8 @@ class LightSource
     virtual LightRay getLightRay(glm::vec3 _destination) const = 0;
 
     ////////////////////////////////////////////////////////////////////////////
-    /// Send light uniform data to the rasterizer
-    virtual void sendLightData(LightUniformLocations _locs) const = 0;
+    /// @return Light data to send to the rasterizer
+    virtual LightData getLightData() const = 0;
 };
 
 #endif // LIGHT_SOURCE_H_
\ No newline at end of file
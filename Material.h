@@ -1,9 +1,12 @@
 #ifndef MATERIAL_H_
 #define MATERIAL_H_
 
+#include <memory>
 #include <string>
 #include <glm/glm.hpp>
 
+class Texture;
+
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Contains paramters used for Blinn-Phong shading of a surface
@@ -39,6 +42,13 @@ struct MaterialConfig {
   std::string keTextureFile;
   std::string normalTextureFile;
   std::string parallaxTextureFile;
+  /// Textures already loaded from the files above, shared between objects.
+  /// Any that are missing are loaded by the object itself.
+  std::shared_ptr<const Texture> kdTexture;
+  std::shared_ptr<const Texture> ksTexture;
+  std::shared_ptr<const Texture> keTexture;
+  std::shared_ptr<const Texture> normalTexture;
+  std::shared_ptr<const Texture> parallaxTexture;
   Material defaultMaterial;
 };
 
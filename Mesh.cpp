@@ -0,0 +1,101 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// GLM half float packing
+#include <glm/gtc/packing.hpp>
+// GLM length2 function
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/norm.hpp>
+
+using glm::vec2, glm::vec3;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Encode a unit vector into 2 snorm16 using octahedral mapping
+void
+encodeOctahedral(vec3 v, int16_t* out) {
+  float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+  if (l1 == 0) {
+    // degenerate vector (e.g. missing tangent), keep it at zero
+    out[0] = out[1] = 0;
+    return;
+  }
+  v /= l1;
+  vec2 e(v.x, v.y);
+  if (v.z < 0) {
+    // fold the lower hemisphere over the diagonals
+    e = vec2((1 - std::abs(v.y)) * (v.x >= 0 ? 1.f : -1.f),
+             (1 - std::abs(v.x)) * (v.y >= 0 ? 1.f : -1.f));
+  }
+  out[0] = (int16_t)std::round(glm::clamp(e.x, -1.f, 1.f) * 32767.f);
+  out[1] = (int16_t)std::round(glm::clamp(e.y, -1.f, 1.f) * 32767.f);
+}
+
+PackedMesh
+packMesh(const Mesh& _mesh) {
+  PackedMesh packed;
+  // find mesh bounds
+  vec3 lo(std::numeric_limits<float>::infinity());
+  vec3 hi(-std::numeric_limits<float>::infinity());
+  for (auto& v : _mesh.vertices) {
+    lo = glm::min(lo, v.p);
+    hi = glm::max(hi, v.p);
+  }
+  if (_mesh.vertices.empty()) {
+    lo = hi = vec3(0, 0, 0);
+  }
+  packed.offset = lo;
+  packed.scale = hi - lo;
+  // avoid dividing by zero on flat meshes
+  vec3 invScale;
+  for (int i = 0; i < 3; i++) {
+    invScale[i] = packed.scale[i] > 0 ? 1 / packed.scale[i] : 0;
+  }
+
+  packed.vertices.reserve(_mesh.vertices.size());
+  for (auto& v : _mesh.vertices) {
+    PackedVertex pv;
+    vec3 p = (v.p - lo) * invScale;
+    for (int i = 0; i < 3; i++) {
+      pv.p[i] = (uint16_t)std::round(glm::clamp(p[i], 0.f, 1.f) * 65535.f);
+    }
+    pv.pad = 0;
+    encodeOctahedral(v.n, pv.n);
+    encodeOctahedral(v.tg, pv.tg);
+    pv.t[0] = glm::packHalf1x16(v.t.x);
+    pv.t[1] = glm::packHalf1x16(v.t.y);
+    packed.vertices.push_back(pv);
+  }
+  return packed;
+}
+
+BoundingSphere
+BoundingSphere::
+transformed(const glm::mat4& _transform) const {
+  // radius grows by the largest scale of the transform
+  float scale = std::sqrt(std::max({glm::length2(vec3(_transform[0])),
+                                    glm::length2(vec3(_transform[1])),
+                                    glm::length2(vec3(_transform[2]))}));
+  return {vec3(_transform * glm::vec4(center, 1)), radius * scale};
+}
+
+BoundingSphere
+computeBoundingSphere(const Mesh& _mesh) {
+  const std::vector<Vertex>& vertices = _mesh.vertices;
+  if (vertices.empty()) {
+    return {vec3(0, 0, 0), 0};
+  }
+  vec3 lo = vertices[0].p;
+  vec3 hi = vertices[0].p;
+  for (auto& v : vertices) {
+    lo = glm::min(lo, v.p);
+    hi = glm::max(hi, v.p);
+  }
+  BoundingSphere bounds{(lo + hi) * 0.5f, 0};
+  for (auto& v : vertices) {
+    bounds.radius = std::max(bounds.radius, glm::length(v.p - bounds.center));
+  }
+  return bounds;
+}
\ No newline at end of file
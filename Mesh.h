@@ -1,8 +1,11 @@
 #ifndef MESH_H_
 #define MESH_H_
 
+#include <cstdint>
 #include <vector>
 
+#include <glm/glm.hpp>
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief One possible storage of vertex information.
 ////////////////////////////////////////////////////////////////////////////////
@@ -22,6 +25,22 @@ struct Vertex {
   Vertex() : Vertex({0,0,0},{0,0,0},{0,0}) {};
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Compact storage of vertex information for the rasterizer.
+///
+/// Takes 20 bytes instead of the 44 bytes of Vertex:
+/// - position is quantized to 16 bits per axis, relative to the mesh bounds
+/// - normal and tangent are octahedral-encoded into 2 snorm16 each
+/// - texture coordinate is stored as 2 half floats
+////////////////////////////////////////////////////////////////////////////////
+struct PackedVertex {
+  uint16_t p[3];  ///< Position, normalized within the mesh bounds
+  uint16_t pad;   ///< Unused, keeps the following fields 4-byte aligned
+  int16_t  n[2];  ///< Octahedral-encoded normal
+  uint16_t t[2];  ///< Half float texture coordinate
+  int16_t  tg[2]; ///< Octahedral-encoded tangent
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief One possible mesh data structure
 ///
@@ -36,4 +55,38 @@ struct Mesh {
     vertices(_vertices) {};
 };
 
-#endif // MESH_H_
\ No newline at end of file
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Sphere enclosing an object, used to cull it cheaply
+////////////////////////////////////////////////////////////////////////////////
+struct BoundingSphere {
+  glm::vec3 center;
+  float radius;
+
+  ////////////////////////////////////////////////////////////////////////////
+  /// @brief Sphere enclosing this one after an affine transform
+  BoundingSphere transformed(const glm::mat4& _transform) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Bounding sphere of a mesh, centered at its bounding box. Empty
+/// meshes get a zero radius sphere at origin.
+BoundingSphere computeBoundingSphere(const Mesh& _mesh);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Mesh with vertices in the compact PackedVertex layout
+///
+/// Position of a vertex is decoded as offset + scale * p / 65535
+////////////////////////////////////////////////////////////////////////////////
+struct PackedMesh {
+  std::vector<PackedVertex> vertices;
+  glm::vec3 offset; ///< Minimum corner of the mesh bounds
+  glm::vec3 scale;  ///< Extent of the mesh bounds
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Quantize and encode a mesh into the compact vertex layout
+/// @param _mesh Mesh to pack
+/// @return Packed mesh, with the bounds needed to decode the positions
+PackedMesh packMesh(const Mesh& _mesh);
+
+#endif // MESH_H_
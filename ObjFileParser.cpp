@@ -1,9 +1,72 @@
 #include "ObjFileParser.h"
 
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 
+/// Indices of the attributes of one corner of a face, -1 if missing
+struct FaceCorner {
+  int p;
+  int t;
+  int n;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Convert a 1-based (or negative, relative to the end) obj index into a
+/// 0-based index into an attribute list of the given size.
+int
+resolveIndex(long _index, size_t _size) {
+  long i = _index < 0 ? (long)_size + _index : _index - 1;
+  if (i < 0 || i >= (long)_size) {
+    throw std::out_of_range("Obj face index out of range");
+  }
+  return (int)i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Parse one face corner of format p, p/t, p//n or p/t/n
+FaceCorner
+parseFaceCorner(const std::string& _corner,
+                size_t _nPositions, size_t _nTextures, size_t _nNormals) {
+  FaceCorner c{-1, -1, -1};
+  const char* str = _corner.c_str();
+  char* end;
+  c.p = resolveIndex(strtol(str, &end, 10), _nPositions);
+  if (*end == '/') {
+    str = end + 1;
+    if (*str != '/') {
+      c.t = resolveIndex(strtol(str, &end, 10), _nTextures);
+    } else {
+      end = (char*)str;
+    }
+    if (*end == '/') {
+      c.n = resolveIndex(strtol(end + 1, &end, 10), _nNormals);
+    }
+  }
+  return c;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Compute the tangent of a triangle from its texture coordinates, then
+/// orthogonalize it against each vertex normal
+void
+computeTangents(Vertex& v0, Vertex& v1, Vertex& v2) {
+  glm::vec3 e1 = v1.p - v0.p;
+  glm::vec3 e2 = v2.p - v0.p;
+  glm::vec2 dt1 = v1.t - v0.t;
+  glm::vec2 dt2 = v2.t - v0.t;
+  float det = dt1.x * dt2.y - dt2.x * dt1.y;
+  glm::vec3 tangent = det != 0
+      ? (e1 * dt2.y - e2 * dt1.y) / det
+      : e1; // no usable texture coordinates, any direction in the face works
+  for (Vertex* v : {&v0, &v1, &v2}) {
+    glm::vec3 tg = tangent - v->n * glm::dot(v->n, tangent);
+    float len = glm::length(tg);
+    v->tg = len > 0 ? tg / len : glm::vec3(0, 0, 0);
+  }
+}
+
 Mesh parseObjFile(const std::string& _filename) {
   std::ifstream ifs(_filename);
   if(!ifs) {
@@ -13,12 +76,13 @@ Mesh parseObjFile(const std::string& _filename) {
   std::vector<glm::vec3> positions;
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> textures;
-  std::vector<Vertex> vertices;
+  // triangulated faces, every three corners form a triangle
+  std::vector<FaceCorner> corners;
+  bool hasMissingNormals = false;
 
   std::string line;
-  while(ifs) {
-    getline(ifs, line);
-
+  std::vector<FaceCorner> face;
+  while(getline(ifs, line)) {
     std::istringstream iss(line);
     std::string tag;
     iss >> tag;
@@ -39,16 +103,55 @@ Mesh parseObjFile(const std::string& _filename) {
       textures.emplace_back(t);
     }
     else if(tag == "f") {
-      for(size_t i = 0; i < 3; ++i) {
-        std::string vert;
-        iss >> vert;
-        size_t p, t, n;
-        sscanf(vert.c_str(), "%zu/%zu/%zu", &p, &t, &n);
-        vertices.emplace_back(positions[p-1], normals[n-1], textures[t-1]);
+      face.clear();
+      std::string vert;
+      while(iss >> vert) {
+        face.emplace_back(parseFaceCorner(
+            vert, positions.size(), textures.size(), normals.size()));
+        hasMissingNormals = hasMissingNormals || face.back().n < 0;
+      }
+      // triangulate polygon as a fan around the first corner
+      for(size_t i = 2; i < face.size(); ++i) {
+        corners.push_back(face[0]);
+        corners.push_back(face[i-1]);
+        corners.push_back(face[i]);
       }
     }
   }
 
+  // generate smooth normals for positions used by corners without normals,
+  // by accumulating area-weighted face normals
+  std::vector<glm::vec3> smoothNormals;
+  if (hasMissingNormals) {
+    smoothNormals.assign(positions.size(), glm::vec3(0, 0, 0));
+    for(size_t i = 0; i < corners.size(); i += 3) {
+      const glm::vec3& p0 = positions[corners[i].p];
+      const glm::vec3& p1 = positions[corners[i+1].p];
+      const glm::vec3& p2 = positions[corners[i+2].p];
+      // cross product length is twice the triangle area
+      glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+      for(size_t j = i; j < i + 3; ++j) {
+        smoothNormals[corners[j].p] += n;
+      }
+    }
+    for(auto& n : smoothNormals) {
+      float len = glm::length(n);
+      n = len > 0 ? n / len : glm::vec3(0, 0, 0);
+    }
+  }
+
+  std::vector<Vertex> vertices;
+  vertices.reserve(corners.size());
+  for(const FaceCorner& c : corners) {
+    vertices.emplace_back(
+        positions[c.p],
+        c.n >= 0 ? normals[c.n] : smoothNormals[c.p],
+        c.t >= 0 ? textures[c.t] : glm::vec2(0, 0));
+  }
+  for(size_t i = 0; i < vertices.size(); i += 3) {
+    computeTangents(vertices[i], vertices[i+1], vertices[i+2]);
+  }
+
   return Mesh(vertices);
 }
 
@@ -11,6 +11,11 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief Parse an obj file into a mesh
+///
+/// Faces may have any number of corners (triangulated as a fan), each in any
+/// of the forms p, p/t, p//n or p/t/n, with negative indices counted from the
+/// end. Missing normals are generated by smoothing face normals, and tangents
+/// are computed from the texture coordinates.
 /// @param _filename Filename
 /// @return Loaded mesh.
 Mesh parseObjFile(const std::string& _filename);
@@ -17,7 +17,11 @@ castRay(const Camera& _cam, int _pixelX, int _pixelY, float _xJitter, float _yJi
   float x = m_planeLeft + m_planeWidth * (_pixelX + 0.5f + _xJitter) / m_frameWidth;
   float y = m_planeBottom + m_planeHeight * (_pixelY + 0.5f + _yJitter) / m_frameHeight;
   glm::vec3 origin = x * _cam.getRight() + y * _cam.getUp() + _cam.getEye();
-  return Ray(origin, _cam.getAt());
+  // moving one pixel moves the origin across the viewing plane
+  Ray::Differentials diffs;
+  diffs.dOdx = m_planeWidth / m_frameWidth * _cam.getRight();
+  diffs.dOdy = m_planeHeight / m_frameHeight * _cam.getUp();
+  return Ray(origin, _cam.getAt(), diffs);
 }
 
 void 
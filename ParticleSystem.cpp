@@ -1,4 +1,7 @@
 #include "ParticleSystem.h"
+
+#include <limits>
+
 using glm::vec3, glm::mat4;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -25,11 +28,14 @@ ParticleSystem(
     m_interraction_coef(_interraction),
     m_generators(std::move(_particleGens)),
     m_particleForces(std::move(_particleForces))
-{}
+{
+  // particles move freely, never cull the system
+  m_worldBounds = {vec3(0, 0, 0), std::numeric_limits<float>::infinity()};
+}
 
 void
 ParticleSystem::
-sendMeshData() {
+sendMeshData(bool) {
   // Create vertex array object
   glGenVertexArrays(1, &m_vao);
   glBindVertexArray(m_vao);
@@ -62,11 +68,11 @@ sendMeshData() {
 
 void
 ParticleSystem::
-draw() {
-  // send object uniform data
-  sendUniformData();
+draw(RenderStateCache& _state) {
+  // bind object uniform data
+  bindObjectData(_state);
   // send particles' positions to shader
-  glBindVertexArray(m_vao);
+  _state.bindVertexArray(m_vao);
   glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
   for (int i = 0; i < m_nParticles; i++) {
     m_buffer[i] = m_particles[i].p;
@@ -80,9 +86,8 @@ draw() {
   // draw
   glDrawArrays(GL_POINTS, 0, m_nParticles);
 
-  // Unbind
+  // Unbind buffer, vertex array stays bound for the next draw
   glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
 }
 
 void
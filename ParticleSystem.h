@@ -26,9 +26,15 @@ class ParticleSystem : public RasterizableObject
         std::vector<std::unique_ptr<ParticleGenerator>>&& _particleGens,
         std::vector<std::unique_ptr<ParticleForce>>&& _particleForces);
 
-    void sendMeshData() override;
+    ////////////////////////////////////////////////////////////////////////////
+    /// Create the buffer particles are streamed to. Particles stay full float
+    /// positions whatever the vertex layout asked for: they are rewritten
+    /// every frame, so quantizing them would cost more than it saves.
+    void sendMeshData(bool) override;
+
+    bool isBatchable() const override { return false; }
 
-    void draw() override;
+    void draw(RenderStateCache& _state) override;
 
     void update(float deltaTime) override;
 
@@ -39,6 +45,10 @@ class ParticleSystem : public RasterizableObject
       return RayHit();
     }
 
+    SurfaceHit surfaceAt(const Ray& _ray, const RayHit& _hit) const override {
+      return {_ray.getOrigin(), -_ray.getDirection(), m_defaultMaterial};
+    }
+
   private:
     /// pool of particles, partitioned into alive and dead particles
     Particle m_particles[MAX_N_PARTICLES];
@@ -19,7 +19,11 @@ castRay(const Camera& _cam, int _pixelX, int _pixelY, float _xJitter, float _yJi
   float x = m_planeLeft + m_planeWidth * (_pixelX + 0.5f + _xJitter) / m_frameWidth;
   float y = m_planeBottom + m_planeHeight * (_pixelY + 0.5f + _yJitter) / m_frameHeight;
   glm::vec3 direction = x * _cam.getRight() + y * _cam.getUp() + _cam.getAt();
-  return Ray(_cam.getEye(), direction);
+  // moving one pixel moves the direction across the viewing plane
+  Ray::Differentials diffs;
+  diffs.dDdx = m_planeWidth / m_frameWidth * _cam.getRight();
+  diffs.dDdy = m_planeHeight / m_frameHeight * _cam.getUp();
+  return Ray(_cam.getEye(), direction, diffs);
 }
 
 void 
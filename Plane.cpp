@@ -7,11 +7,16 @@ intersectRay(Ray _ray) const {
   glm::vec3 d = _ray.getDirection();
 
   float denom = glm::dot(d, m_normal);
-  RayHit hit;
   if (denom == 0) {
     return RayHit();
   }
   float t = glm::dot(m_point - p, m_normal) / denom;
-  glm::vec3 hitPos = p + d * t;
-  return {t, hitPos, m_normal, m_defaultMaterial};
+  return {t, {0, 0}, 0, this};
+}
+
+SurfaceHit
+Plane::
+surfaceAt(const Ray& _ray, const RayHit& _hit) const {
+  glm::vec3 hitPos = _ray.getOrigin() + _ray.getDirection() * _hit.t;
+  return {hitPos, m_normal, m_defaultMaterial};
 }
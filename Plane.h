@@ -20,6 +20,8 @@ class Plane : public RayTracableObject
     }
     
     RayHit intersectRay(Ray _ray) const;
+
+    SurfaceHit surfaceAt(const Ray& _ray, const RayHit& _hit) const override;
   
   private:
     /// A point wihin the plane
@@ -15,13 +15,15 @@ getLightRay(glm::vec3 _destination) const {
   };
 }
 
-void 
+LightData
 PointLight::
-sendLightData(LightUniformLocations locations) const {
-  glUniform1i(locations.type, 1); // type 1 is point light
-  glUniform3fv(locations.pos, 1, glm::value_ptr(m_pos));
-  glUniform3fv(locations.intensityAmbient,  1, glm::value_ptr(m_intensityAmbient));
-  glUniform3fv(locations.intensityDiffuse,  1, glm::value_ptr(m_intensityDiffuse));
-  glUniform3fv(locations.intensitySpecular, 1, glm::value_ptr(m_intensitySpecular));
-  glUniform3fv(locations.linearAttenuation, 1, glm::value_ptr(m_linearAttenuation));
+getLightData() const {
+  LightData data{};
+  data.type = 1; // type 1 is point light
+  data.pos = m_pos;
+  data.ia = m_intensityAmbient;
+  data.id = m_intensityDiffuse;
+  data.is = m_intensitySpecular;
+  data.al = m_linearAttenuation;
+  return data;
 }
\ No newline at end of file
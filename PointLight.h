@@ -30,8 +30,8 @@ class PointLight : public LightSource
     LightRay getLightRay(glm::vec3 _destination) const;
 
     ////////////////////////////////////////////////////////////////////////////
-    /// Send light uniform data to the rasterizer
-    void sendLightData(LightUniformLocations _locs) const;
+    /// @return Light data to send to the rasterizer
+    LightData getLightData() const;
 
 
   private:
@@ -41,24 +41,32 @@ Portal(glm::vec3 _center1, float _radius1, glm::vec3 _normal1, glm::vec3 _up1,
 RayHit 
 Portal::
 intersectRay(Ray _ray) const {
-  RayHit hit = sides[0].circle.intersectRay(_ray);
-  if (hit.t > 0) {
-    return transformHit(sides[0], sides[1], hit, _ray.getDirection());
-  }
-  hit = sides[1].circle.intersectRay(_ray);
-  if (hit.t > 0) {
-    return transformHit(sides[1], sides[0], hit, _ray.getDirection());
+  for (size_t i = 0; i < sides.size(); i++) {
+    RayHit hit = sides[i].circle.intersectRay(_ray);
+    if (hit.t > 0) {
+      // the primitive is the side hit
+      return {hit.t, {0, 0}, i, this};
+    }
   }
   return RayHit();
 }
 
-RayHit
+SurfaceHit
+Portal::
+surfaceAt(const Ray& _ray, const RayHit& _hit) const {
+  const PortalSide& inSide = sides[_hit.primitive];
+  const PortalSide& outSide = sides[1 - _hit.primitive];
+  SurfaceHit hit = inSide.circle.surfaceAt(_ray, _hit);
+  return transformHit(inSide, outSide, hit, _ray.getDirection());
+}
+
+SurfaceHit
 Portal::
 transformHit(const PortalSide& inSide, 
-    const PortalSide& outSide, const RayHit& hit, glm::vec3 viewDir) const
+    const PortalSide& outSide, const SurfaceHit& hit, glm::vec3 viewDir) const
 {
-  RayHit transformedHit;
-  transformedHit.t = hit.t;
+  SurfaceHit transformedHit;
+  transformedHit.material = m_defaultMaterial;
   // transform the position from the hit side to the other side
   glm::vec3 p = hit.position - inSide.circle.getCenter();
   transformedHit.position = outSide.circle.getCenter()
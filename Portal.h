@@ -15,6 +15,8 @@ class Portal : public RayTracableObject
 
     RayHit intersectRay(Ray _ray) const override;
 
+    SurfaceHit surfaceAt(const Ray& _ray, const RayHit& _hit) const override;
+
   private:
     struct PortalSide {
       Circle circle;
@@ -28,8 +30,8 @@ class Portal : public RayTracableObject
     /// Transform the hit info of the ray hit from inSide such that the
     /// reflected ray starts from the other side (outSide) and head in the
     /// correct direction
-    RayHit transformHit(const PortalSide& inSide, 
-        const PortalSide& outSide, const RayHit& hit, glm::vec3 viewDir) const;
+    SurfaceHit transformHit(const PortalSide& inSide, 
+        const PortalSide& outSide, const SurfaceHit& hit, glm::vec3 viewDir) const;
 };
 
 #endif // PORTAL_H_
\ No newline at end of file
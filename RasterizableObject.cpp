@@ -1,5 +1,6 @@
 #include "RasterizableObject.h"
 
+#include <cstddef>
 #include <limits>
 
 using glm::cross, glm::dot, glm::value_ptr, glm::vec2, glm::vec3, glm::vec4;
@@ -9,18 +10,103 @@ RasterizableObject::
 RasterizableObject(const Mesh& _mesh, 
                    const MaterialConfig& _materialConfig,
                    const glm::mat4& _modelMatrix)
+  : RasterizableObject(
+      std::make_shared<const Mesh>(_mesh), _materialConfig, _modelMatrix)
+{}
+
+RasterizableObject::
+RasterizableObject(std::shared_ptr<const Mesh> _mesh, 
+                   const MaterialConfig& _materialConfig,
+                   const glm::mat4& _modelMatrix)
   : RayTracableObject(_materialConfig),
-    m_mesh(_mesh),
-    m_nVertices(_mesh.vertices.size()),
+    m_mesh(std::move(_mesh)),
+    m_nVertices(m_mesh->vertices.size()),
+    m_lods{{m_mesh, 0, 0}},
+    m_lod(0),
     m_vModelMatrix(_modelMatrix),
     m_nModelMatrix(glm::transpose(glm::inverse(_modelMatrix))),
-    m_vao(0)
+    m_vao(0),
+    m_firstVertex(0),
+    m_hasPackedVertices(false),
+    m_positionOffset(0, 0, 0),
+    m_positionScale(1, 1, 1),
+    m_objectDataBuffer(0),
+    m_objectDataOffset(0),
+    m_program(0),
+    m_depthProgram(0),
+    m_stateKey(0),
+    m_worldBounds(computeBoundingSphere(*m_mesh).transformed(_modelMatrix))
 {}
 
 
+const float RasterizableObject::LOD_HYSTERESIS = 0.2f;
+const float RasterizableObject::LOD_SEGMENT_PIXELS = 12.f;
+
 void
 RasterizableObject::
-sendMeshData() {
+setLods(const std::vector<Mesh>& _meshes, 
+        const std::vector<float>& _minScreenRadii) {
+  m_lods.clear();
+  for (size_t i = 0; i < _meshes.size(); i++) {
+    m_lods.push_back({std::make_shared<const Mesh>(_meshes[i]), 
+                      _minScreenRadii[i], 0});
+  }
+  m_lods.back().minScreenRadius = 0;
+  m_lod = 0;
+}
+
+void
+RasterizableObject::
+selectLod(float _screenRadius) {
+  // finer levels as soon as the object is large enough for them
+  while (m_lod > 0 && _screenRadius >= m_lods[m_lod - 1].minScreenRadius) {
+    m_lod--;
+  }
+  // coarser levels once the object is clearly too small for the current one
+  while (m_lod + 1 < m_lods.size() 
+         && _screenRadius < m_lods[m_lod].minScreenRadius * (1 - LOD_HYSTERESIS)) {
+    m_lod++;
+  }
+}
+
+void
+RasterizableObject::
+appendMeshData(bool _isCompact, std::vector<char>& _vertices) {
+  // Levels of detail follow each other, and are packed together so that they
+  // share the position decoding in the object data
+  Mesh levels;
+  const Mesh* mesh = m_lods[0].mesh.get();
+  if (m_lods.size() > 1) {
+    for (LodLevel& lod : m_lods) {
+      lod.firstVertex = levels.vertices.size();
+      levels.vertices.insert(levels.vertices.end(), 
+          lod.mesh->vertices.begin(), lod.mesh->vertices.end());
+    }
+    mesh = &levels;
+  }
+  size_t nVertices = mesh->vertices.size();
+
+  m_hasPackedVertices = _isCompact;
+  if (_isCompact) {
+    PackedMesh packed = packMesh(*mesh);
+    m_positionOffset = packed.offset;
+    m_positionScale = packed.scale;
+    const char* data = (const char*)packed.vertices.data();
+    _vertices.insert(_vertices.end(), 
+                     data, data + sizeof(PackedVertex) * nVertices);
+  } else {
+    const char* data = (const char*)mesh->vertices.data();
+    _vertices.insert(_vertices.end(), 
+                     data, data + sizeof(Vertex) * nVertices);
+  }
+}
+
+void
+RasterizableObject::
+sendMeshData(bool _isCompact) {
+  std::vector<char> vertices;
+  appendMeshData(_isCompact, vertices);
+
   // Create vertex array object
   glGenVertexArrays(1, &m_vao);
   glBindVertexArray(m_vao);
@@ -29,29 +115,8 @@ sendMeshData() {
   GLuint vbo;
   glGenBuffers(1, &vbo);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, 
-               sizeof(Vertex) * m_nVertices, 
-               &m_mesh.vertices[0], 
-               GL_STATIC_DRAW);
-  // Specify vertex attributes within buffer (interleave)
-  // - positions
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), 0);
-  // - normals
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), (void*)sizeof(vec3));
-  // - textures
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), 
-                        (void*)(sizeof(vec3)*2));
-  // - tangent
-  glEnableVertexAttribArray(3);
-  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), 
-                        (void*)(sizeof(vec3)*2+sizeof(vec2)));
+  glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+  setVertexAttributes(_isCompact);
 
   // Unbind
   glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -60,44 +125,153 @@ sendMeshData() {
 
 void
 RasterizableObject::
-sendUniformData() {
-  // set tranformation uniforms
-  glUniformMatrix4fv(m_uniformLocations.vertexModelMatrix, 
-                     1, GL_FALSE, value_ptr(m_vModelMatrix));
-  glUniformMatrix4fv(m_uniformLocations.normalModelMatrix, 
-                     1, GL_FALSE, value_ptr(m_nModelMatrix));
-  // set material/texture uniform
+setVertexAttributes(bool _isCompact) {
+  if (_isCompact) {
+    // Specify vertex attributes within buffer (interleave), decoded in shader
+    // - positions, normalized to [0, 1] within mesh bounds
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+                          sizeof(PackedVertex), 
+                          (void*)offsetof(PackedVertex, p));
+    // - normals, octahedral encoded
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE,
+                          sizeof(PackedVertex), 
+                          (void*)offsetof(PackedVertex, n));
+    // - textures, half floats
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE,
+                          sizeof(PackedVertex), 
+                          (void*)offsetof(PackedVertex, t));
+    // - tangent, octahedral encoded
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE,
+                          sizeof(PackedVertex), 
+                          (void*)offsetof(PackedVertex, tg));
+  } else {
+    // Specify vertex attributes within buffer (interleave)
+    // - positions
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+                          sizeof(Vertex), 0);
+    // - normals
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
+                          sizeof(Vertex), (void*)sizeof(vec3));
+    // - textures
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
+                          sizeof(Vertex), 
+                          (void*)(sizeof(vec3)*2));
+    // - tangent
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE,
+                          sizeof(Vertex), 
+                          (void*)(sizeof(vec3)*2+sizeof(vec2)));
+  }
+}
+
+void
+RasterizableObject::
+setSharedVertices(GLuint _vao, GLint _firstVertex) {
+  m_vao = _vao;
+  m_firstVertex = _firstVertex;
+}
+
+ObjectData
+RasterizableObject::
+getObjectData() const {
+  ObjectData data{};
+  // tranformation
+  data.vertexModelMatrix = m_vModelMatrix;
+  data.normalModelMatrix = m_nModelMatrix;
+  // vertex decoding
+  data.positionOffset = m_positionOffset;
+  data.positionScale = m_positionScale;
+  // texture maps
+  data.flags = 
+      (m_hasTransparency            ? FLAG_TRANSPARENCY    : 0) |
+      (m_kdTexture->isValid()       ? FLAG_KD_MAP          : 0) |
+      (m_ksTexture->isValid()       ? FLAG_KS_MAP          : 0) |
+      (m_keTexture->isValid()       ? FLAG_KE_MAP          : 0) |
+      (m_normalTexture->isValid()   ? FLAG_NORMAL_MAP      : 0) |
+      (m_parallaxTexture->isValid() ? FLAG_PARALLAX_MAP    : 0) |
+      (m_hasPackedVertices          ? FLAG_PACKED_VERTICES : 0);
+  // layers of the maps packed in texture arrays, which are all or none of
+  // them since the asset manager packs every texture or none
+  for (const Texture* map : getTextures()) {
+    if (map->isValid() && map->getTarget() == GL_TEXTURE_2D_ARRAY) {
+      data.flags |= FLAG_TEXTURE_ARRAYS;
+    }
+  }
+  data.mapLayers = glm::ivec4(m_kdTexture->getLayer(), m_ksTexture->getLayer(),
+                              m_keTexture->getLayer(), m_normalTexture->getLayer());
+  data.parallaxLayer = m_parallaxTexture->getLayer();
+  // default material
   const Material& m = m_defaultMaterial;
-  // set texture uniforms
-  glUniform1i(m_uniformLocations.hasTransparency, m_hasTransparency);
-  glUniform1i(m_uniformLocations.hasKdMap, m_kdTexture.isValid());
-  glUniform1i(m_uniformLocations.hasKsMap, m_ksTexture.isValid());
-  glUniform1i(m_uniformLocations.hasKeMap, m_keTexture.isValid());
-  glUniform1i(m_uniformLocations.hasNormalMap, m_normalTexture.isValid());
-  glUniform1i(m_uniformLocations.hasParallaxMap, m_parallaxTexture.isValid());
-  m_kdTexture.activate(GL_TEXTURE0);
-  m_ksTexture.activate(GL_TEXTURE1);
-  m_keTexture.activate(GL_TEXTURE2);
-  m_normalTexture.activate(GL_TEXTURE3);
-  m_parallaxTexture.activate(GL_TEXTURE4);
-  // set default material uniforms
-  glUniform3fv(m_uniformLocations.material.ka, 1, value_ptr(m.ka));
-  glUniform3fv(m_uniformLocations.material.kd, 1, value_ptr(m.kd));
-  glUniform3fv(m_uniformLocations.material.ks, 1, value_ptr(m.ks));
-  glUniform3fv(m_uniformLocations.material.ke, 1, value_ptr(m.ke));
-  glUniform1f (m_uniformLocations.material.shininess, m.shininess);
-  glUniform1f (m_uniformLocations.material.transparency, m.transparency);
+  data.material.ka = m.ka;
+  data.material.kd = m.kd;
+  data.material.ks = m.ks;
+  data.material.ke = m.ke;
+  data.material.shininess = m.shininess;
+  data.material.transparency = m.transparency;
+  return data;
+}
+
+std::array<const Texture*, RasterizableObject::N_TEXTURE_MAPS>
+RasterizableObject::
+getTextures() const {
+  return {m_kdTexture.get(), m_ksTexture.get(), m_keTexture.get(), 
+          m_normalTexture.get(), m_parallaxTexture.get()};
+}
+
+std::array<GLuint, RasterizableObject::N_TEXTURE_MAPS>
+RasterizableObject::
+getTextureIds() const {
+  return {
+    m_kdTexture->isValid()       ? m_kdTexture->getId()       : 0,
+    m_ksTexture->isValid()       ? m_ksTexture->getId()       : 0,
+    m_keTexture->isValid()       ? m_keTexture->getId()       : 0,
+    m_normalTexture->isValid()   ? m_normalTexture->getId()   : 0,
+    m_parallaxTexture->isValid() ? m_parallaxTexture->getId() : 0,
+  };
+}
+
+void
+RasterizableObject::
+bindObjectData(RenderStateCache& _state) {
+  _state.bindUniformBufferRange(OBJECT_DATA_BINDING, m_objectDataBuffer, 
+                                m_objectDataOffset, OBJECT_DATA_BLOCK_SIZE);
+  // maps the object doesn't have are not sampled, so whatever is bound to
+  // their unit can stay
+  std::array<const Texture*, N_TEXTURE_MAPS> textures = getTextures();
+  for (GLuint unit = 0; unit < N_TEXTURE_MAPS; unit++) {
+    if (textures[unit]->isValid()) {
+      _state.bindTexture(unit, textures[unit]->getId(), 
+                         textures[unit]->getTarget());
+    }
+  }
 }
 
 void
 RasterizableObject::
-draw() {
+draw(RenderStateCache& _state) {
   // set the object uniform data
-  sendUniformData();
+  bindObjectData(_state);
   // draw
-  glBindVertexArray(m_vao);
-  glDrawArrays(GL_TRIANGLES, 0, m_nVertices);
-  glBindVertexArray(0);
+  _state.bindVertexArray(m_vao);
+  glDrawArrays(GL_TRIANGLES, getFirstVertex(), getNumVertices());
+}
+
+void
+RasterizableObject::
+drawBatch(RenderStateCache& _state,
+          const std::vector<GLint>& _firsts,
+          const std::vector<GLsizei>& _counts) {
+  bindObjectData(_state);
+  _state.bindVertexArray(m_vao);
+  glMultiDrawArrays(GL_TRIANGLES, _firsts.data(), _counts.data(), 
+                    _firsts.size());
 }
 
 Vertex 
@@ -118,19 +292,47 @@ intersectRay(Ray _ray) const {
   RayHit hitResult;
   bool isHit = false;
   hitResult.t = std::numeric_limits<float>::infinity();
-  for (int i = 0; i < m_nVertices; i+=3) {
-    isHit = isHit || intersectRayTriangle(
-      _ray,
-      vertexToWorld(m_mesh.vertices[i]), 
-      vertexToWorld(m_mesh.vertices[i+1]), 
-      vertexToWorld(m_mesh.vertices[i+2]), 
-      &hitResult);
+  for (size_t i = 0; i < m_nVertices; i+=3) {
+    if (intersectRayTriangle(
+          _ray,
+          vertexToWorld(m_mesh->vertices[i]), 
+          vertexToWorld(m_mesh->vertices[i+1]), 
+          vertexToWorld(m_mesh->vertices[i+2]), 
+          &hitResult)) {
+      hitResult.primitive = i;
+      isHit = true;
+    }
   }
   if (!isHit) return RayHit();
-  // convert hit result back to world coordinate
+  hitResult.object = this;
   return hitResult;
 }
 
+SurfaceHit
+RasterizableObject::
+surfaceAt(const Ray& _ray, const RayHit& _hit) const {
+  const std::vector<Vertex>& vertices = m_mesh->vertices;
+  return surfaceAtTriangle(_ray, _hit.barycentric,
+                           vertexToWorld(vertices[_hit.primitive]),
+                           vertexToWorld(vertices[_hit.primitive + 1]),
+                           vertexToWorld(vertices[_hit.primitive + 2]));
+}
+
+bool
+RasterizableObject::
+intersectModelMesh(Ray _modelRay, RayHit* hitResult) const {
+  bool isHit = false;
+  const std::vector<Vertex>& vertices = m_mesh->vertices;
+  for (size_t i = 0; i < m_nVertices; i+=3) {
+    if (intersectRayTriangle(
+          _modelRay, vertices[i], vertices[i+1], vertices[i+2], hitResult)) {
+      hitResult->primitive = i;
+      isHit = true;
+    }
+  }
+  return isHit;
+}
+
 bool
 RasterizableObject::
 intersectRayTriangle(
@@ -172,25 +374,64 @@ intersectRayTriangle(
   // hit time
   float t = dot(e2, qVec) * invDet;
   if (t <= SELF_INTERSECTION_BIAS || hitResult->t <= t) return false;
-  float a = 1 - b - c;
 
-  // actual hit, compute hit result
+  // actual hit, the surface is only evaluated for the closest one
   hitResult->t = t;
-  hitResult->position = rayOrigin + rayDir*t;
-  hitResult->normal = a*v0.n + b*v1.n + c*v2.n;
-  
+  hitResult->barycentric = vec2(b, c);
+  return true;
+}
+
+SurfaceHit
+RasterizableObject::
+surfaceAtTriangle(
+    const Ray& ray,
+    vec2 barycentric,
+    const Vertex& v0, 
+    const Vertex& v1, 
+    const Vertex& v2) const {
+  float b = barycentric.x;
+  float c = barycentric.y;
+  float a = 1 - b - c;
+  SurfaceHit hit;
+  hit.position = a*v0.p + b*v1.p + c*v2.p;
+  hit.normal = glm::normalize(a*v0.n + b*v1.n + c*v2.n);
+
   // compute material at intersection point using texture
-  hitResult->material = m_defaultMaterial;
+  hit.material = m_defaultMaterial;
   // interpolate texture coordinate
   vec2 texCoord = a*v0.t + b*v1.t + c*v2.t;
-  if (m_kdTexture.isValid()) {
-    hitResult->material.kd = m_kdTexture.sample(texCoord);
+  // footprint of the pixel in texture space, from the ray differentials
+  vec2 dUVdx(0, 0);
+  vec2 dUVdy(0, 0);
+  if (ray.hasDifferentials()) {
+    vec3 e1 = v1.p - v0.p;
+    vec3 e2 = v2.p - v0.p;
+    vec3 normal = cross(e1, e2);
+    float t = dot(hit.position - ray.getOrigin(), ray.getDirection());
+    vec3 dPdx, dPdy;
+    ray.getHitDifferentials(t, normal, dPdx, dPdy);
+    // gradients of the barycentric coordinates (b, c) in the triangle plane
+    float nn = dot(normal, normal);
+    vec3 gradB = cross(e2, normal) / nn;
+    vec3 gradC = cross(normal, e1) / nn;
+    vec2 dt1 = v1.t - v0.t;
+    vec2 dt2 = v2.t - v0.t;
+    dUVdx = dot(dPdx, gradB) * dt1 + dot(dPdx, gradC) * dt2;
+    dUVdy = dot(dPdy, gradB) * dt1 + dot(dPdy, gradC) * dt2;
   }
-  if (m_ksTexture.isValid()) {
-    hitResult->material.ks = m_kdTexture.sample(texCoord);
+  if (m_kdTexture->isValid()) {
+    vec4 texel = m_kdTexture->sample(texCoord, dUVdx, dUVdy);
+    hit.material.kd = vec3(texel);
+    // as in the rasterizer, the alpha of the diffuse map is the transparency
+    if (m_hasTransparency) {
+      hit.material.transparency = texel.w;
+    }
   }
-  if (m_keTexture.isValid()) {
-    hitResult->material.ke = m_keTexture.sample(texCoord);
+  if (m_ksTexture->isValid()) {
+    hit.material.ks = vec3(m_ksTexture->sample(texCoord, dUVdx, dUVdy));
   }
-  return true;
+  if (m_keTexture->isValid()) {
+    hit.material.ke = vec3(m_keTexture->sample(texCoord, dUVdx, dUVdy));
+  }
+  return hit;
 }
\ No newline at end of file
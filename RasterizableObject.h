@@ -1,36 +1,19 @@
 #ifndef RASTERIZABLE_OBJECT_H_
 #define RASTERIZABLE_OBJECT_H_
 
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "GLInclude.h"
 #include "Mesh.h"
 #include "RayTracableObject.h"
+#include "RenderStateCache.h"
+#include "UniformBlocks.h"
 
 
-/// The locations of uniforms related to material in rasterizer
-struct MaterialUniformLocations {
-  GLint ka;
-  GLint kd;
-  GLint ks;
-  GLint ke;
-  GLint shininess;
-  GLint transparency;
-};
-
-/// The locations of uniforms related the objects in rasterizer
-struct ObjectUniformLocations {
-  GLint vertexModelMatrix;
-  GLint normalModelMatrix;
-  GLint hasTransparency;
-  GLint hasKdMap;
-  GLint hasKsMap;
-  GLint hasKeMap;
-  GLint hasNormalMap;
-  GLint hasParallaxMap;
-  MaterialUniformLocations material;
-};
-
 class RasterizableObject : public RayTracableObject
 {
   public:
@@ -38,13 +21,140 @@ class RasterizableObject : public RayTracableObject
                        const MaterialConfig& _materialConfig,
                        const glm::mat4& _modelMatrix);
 
-    virtual void setUniformLocations(const ObjectUniformLocations& _locs) {
-      m_uniformLocations = _locs;
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Create an object from a mesh that may be shared with others
+    RasterizableObject(std::shared_ptr<const Mesh> _mesh, 
+                       const MaterialConfig& _materialConfig,
+                       const glm::mat4& _modelMatrix);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Per-object data for the ObjectData uniform block. Only valid
+    /// after sendMeshData.
+    virtual ObjectData getObjectData() const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Set where getObjectData has been uploaded, to bind it before drawing
+    /// @param _buffer Uniform buffer holding the data
+    /// @param _offset Offset of the ObjectData array holding the object's
+    ///                data, OBJECT_DATA_BLOCK_SIZE bytes are bound from it
+    void setObjectDataRange(GLuint _buffer, GLintptr _offset) {
+      m_objectDataBuffer = _buffer;
+      m_objectDataOffset = _offset;
     };
 
-    virtual void sendMeshData();
+    GLintptr getObjectDataOffset() const { return m_objectDataOffset; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Upload the mesh to the GPU, in a vertex array of its own
+    /// @param _isCompact Use the quantized PackedVertex layout instead of
+    ///                   full float vertices
+    virtual void sendMeshData(bool _isCompact);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Whether the mesh can go in a vertex buffer shared with other objects,
+    /// using appendMeshData and setSharedVertices instead of sendMeshData.
+    /// Only for objects drawn with a plain draw of their static mesh.
+    virtual bool isBatchable() const { return true; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Encode the mesh at the end of a vertex buffer shared with other objects
+    /// @param _isCompact Use the quantized PackedVertex layout instead of
+    ///                   full float vertices
+    /// @param _vertices  Vertex data the mesh is appended to
+    void appendMeshData(bool _isCompact, std::vector<char>& _vertices);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Draw from a shared vertex array, once appendMeshData has been uploaded
+    /// @param _vao         Vertex array of the shared buffer
+    /// @param _firstVertex Index of the first vertex of the mesh in the buffer
+    void setSharedVertices(GLuint _vao, GLint _firstVertex);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Set the mesh attributes of the bound array buffer in the bound vertex
+    /// array, at locations 0 to 3
+    static void setVertexAttributes(bool _isCompact);
 
-    virtual void draw();
+    /// Location of the attribute indexing the ObjectData array for batched
+    /// draws
+    static const GLuint BATCH_INDEX_LOCATION = 12;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Draw the object, binding state through the cache. Bindings are left in
+    /// place for the next draw.
+    virtual void draw(RenderStateCache& _state);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Draw several objects sharing this object's vertex array, object data
+    /// and textures in one call
+    /// @param _firsts First vertex of each object
+    /// @param _counts Number of vertices of each object
+    void drawBatch(RenderStateCache& _state,
+                   const std::vector<GLint>& _firsts,
+                   const std::vector<GLsizei>& _counts);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Whether the shader may discard fragments of the object, which a depth
+    /// only pass can't reproduce
+    bool mayDiscardFragments() const { return m_parallaxTexture->isValid(); }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Vertex range of the selected level of detail in the vertex array
+    GLint getFirstVertex() const { return m_firstVertex + m_lods[m_lod].firstVertex; }
+    GLsizei getNumVertices() const { return m_lods[m_lod].mesh->vertices.size(); }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Replace the rasterized mesh by a chain of levels of detail. Must be
+    /// called before the mesh is uploaded. The ray traced mesh is unchanged.
+    /// @param _meshes         Mesh of each level in model space, from finest to
+    ///                        coarsest
+    /// @param _minScreenRadii Smallest radius on screen, in pixels, of the
+    ///                        bounding sphere at which each level is drawn.
+    ///                        Decreasing, the last one is ignored.
+    void setLods(const std::vector<Mesh>& _meshes, 
+                 const std::vector<float>& _minScreenRadii);
+
+    bool hasLods() const { return m_lods.size() > 1; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Select the level of detail drawn from the size of the object on screen.
+    /// A coarser level is only selected once the object is clearly smaller
+    /// than needed for the current one, so that it doesn't pop back and forth.
+    /// @param _screenRadius Radius of the bounding sphere on screen, in pixels
+    void selectLod(float _screenRadius);
+
+    /// Number of texture maps an object can bind
+    static const int N_TEXTURE_MAPS = 5;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Names of the texture maps bound when drawing, in texture unit
+    /// order, 0 for maps the object doesn't have
+    std::array<GLuint, N_TEXTURE_MAPS> getTextureIds() const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Texture maps in texture unit order, invalid for maps the object
+    /// doesn't have
+    std::array<const Texture*, N_TEXTURE_MAPS> getTextures() const;
+
+    GLuint getVao() const { return m_vao; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Program shading the object, bound by the renderer before draw
+    GLuint getProgram() const { return m_program; }
+    void setProgram(GLuint _program) { m_program = _program; }
+
+    /// Program writing the object depth in the depth pre-pass, specialized
+    /// like the shading program so that both compute the same positions
+    GLuint getDepthProgram() const { return m_depthProgram; }
+    void setDepthProgram(GLuint _program) { m_depthProgram = _program; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// State part of the key sorting the object in a RenderQueue
+    uint64_t getStateKey() const { return m_stateKey; }
+    void setStateKey(uint64_t _key) { m_stateKey = _key; }
+
+    /// Fraction of the minimum screen radius of a level of detail by which an
+    /// object must get smaller to switch to a coarser level
+    static const float LOD_HYSTERESIS;
 
     /// Ray hit with t not exceeding this amount is treated as
     /// an object hitting itself, and thus doesn't count as hitting
@@ -53,38 +163,98 @@ class RasterizableObject : public RayTracableObject
 
     RayHit intersectRay(Ray _ray) const override;
 
+    SurfaceHit surfaceAt(const Ray& _ray, const RayHit& _hit) const override;
+
     virtual glm::vec3 getRoughPosition() const { return m_vModelMatrix[3]; };
 
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Sphere enclosing the object in world space, used for culling
+    const BoundingSphere& getWorldBounds() const { return m_worldBounds; }
+
   protected:
-    Mesh m_mesh;
+    /// Level of detail of the rasterized mesh
+    struct LodLevel {
+      std::shared_ptr<const Mesh> mesh;
+      /// Smallest radius of the object on screen the level is drawn at
+      float minScreenRadius;
+      /// Index of the level's first vertex from the object's first vertex
+      GLint firstVertex;
+    };
+
+    /// Mesh in model space, possibly shared with other objects
+    std::shared_ptr<const Mesh> m_mesh;
     /// Number of vertices in the mesh
     size_t m_nVertices;
+    /// Rasterized levels of detail, from finest to coarsest. Only holds
+    /// m_mesh unless setLods was called.
+    std::vector<LodLevel> m_lods;
+    /// Index of the selected level of detail
+    size_t m_lod;
+    /// Largest size of a tessellation segment on screen, in pixels, before a
+    /// finer level of detail is needed. For objects tessellated in their
+    /// constructor.
+    static const float LOD_SEGMENT_PIXELS;
     /// Transformation of vertex from model to world
     glm::mat4 m_vModelMatrix;
     /// Transformation of normal from model to world
     glm::mat4 m_nModelMatrix;
     /// Name of vertex array object for this object
     GLuint m_vao;
-    /// Location of uniform to send object data
-    ObjectUniformLocations m_uniformLocations;
+    /// Index of the first vertex of the mesh in the vertex array
+    GLint m_firstVertex;
+    /// Whether the uploaded vertices use the PackedVertex layout
+    bool m_hasPackedVertices;
+    /// Offset and scale to decode packed vertex positions
+    glm::vec3 m_positionOffset;
+    glm::vec3 m_positionScale;
+    /// Uniform buffer range holding the object data
+    GLuint m_objectDataBuffer;
+    GLintptr m_objectDataOffset;
+    /// Program shading the object
+    GLuint m_program;
+    /// Program of the depth pre-pass, 0 if not drawn in it
+    GLuint m_depthProgram;
+    /// State part of the render queue sort key
+    uint64_t m_stateKey;
+    /// Sphere enclosing the object in world space, infinite if the object
+    /// can't be bounded
+    BoundingSphere m_worldBounds;
 
     ////////////////////////////////////////////////////////////////////////////
-    // Set the object uniforms before draw call
-    void sendUniformData();
+    // Bind the object data and textures before draw call
+    void bindObjectData(RenderStateCache& _state);
 
     ////////////////////////////////////////////////////////////////////////////
     // Transform the vertex to world coordinate
     Vertex vertexToWorld(const Vertex& v) const;
 
+    ////////////////////////////////////////////////////////////////////////////
+    /// Intersect a ray with the mesh in model space, without applying the
+    /// model matrix. Hit result is in model space too, its object is not set.
+    /// @return whether the ray hits the mesh
+    bool intersectModelMesh(Ray _modelRay, RayHit* hitResult) const;
+
     ////////////////////////////////////////////////////////////////////////////
     /// Check if ray intersect a triangle, and that the intersection is closer 
-    /// to the ray origin. Write hit result into hitResult param.
+    /// to the ray origin. Write the distance and barycentric coordinates of
+    /// the hit into hitResult param, leaving the rest to the caller.
     /// @return whether the ray intersects the triangle closer to the current hit
     bool intersectRayTriangle(Ray ray,
                               const Vertex& v0, 
                               const Vertex& v1, 
                               const Vertex& v2, 
                               RayHit* hitResult) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Evaluate the surface of a triangle hit by a ray, sampling the texture
+    /// maps. Vertices and result are in the space of the ray.
+    /// @param barycentric Barycentric coordinates of the hit, from
+    ///                    intersectRayTriangle
+    SurfaceHit surfaceAtTriangle(const Ray& ray,
+                                 glm::vec2 barycentric,
+                                 const Vertex& v0, 
+                                 const Vertex& v1, 
+                                 const Vertex& v2) const;
 };
 
 #endif // RASTERIZABLE_OBJECT_H_
\ No newline at end of file
@@ -4,79 +4,256 @@
 #include "GLInclude.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
 #include <vector>
-#include "PointLight.h"
 
 using glm::vec3, glm::mat4;
 
+// The flags stand in for the shader variant in the render queue sort keys, so
+// all of them, up to the highest one, must fit its bits
+static_assert(FLAG_TEXTURE_ARRAYS < (1 << RenderQueue::SHADER_VARIANT_BITS),
+              "object flags don't fit the shader variant of sort keys");
+
+////////////////////////////////////////////////////////////////////////////////
+/// Defines specializing the phong shaders for objects with the given flags,
+/// see uniform_blocks.glsl
+std::vector<std::string>
+getShaderDefines(GLint _flags) {
+  static const std::pair<const char*, GLint> FEATURES[] = {
+    {"HAS_TRANSPARENCY",    FLAG_TRANSPARENCY},
+    {"HAS_KD_MAP",          FLAG_KD_MAP},
+    {"HAS_KS_MAP",          FLAG_KS_MAP},
+    {"HAS_KE_MAP",          FLAG_KE_MAP},
+    {"HAS_NORMAL_MAP",      FLAG_NORMAL_MAP},
+    {"HAS_PARALLAX_MAP",    FLAG_PARALLAX_MAP},
+    {"HAS_PACKED_VERTICES", FLAG_PACKED_VERTICES},
+    {"HAS_INSTANCES",       FLAG_INSTANCES},
+    {"HAS_TEXTURE_ARRAYS",  FLAG_TEXTURE_ARRAYS},
+  };
+  std::vector<std::string> defines;
+  for (auto& feature : FEATURES) {
+    defines.push_back(std::string(feature.first) 
+                      + ((_flags & feature.second) ? " 1" : " 0"));
+  }
+  return defines;
+}
+
 Rasterizer::
 Rasterizer(int frameWidth, int frameHeight)
-  : Renderer(frameWidth, frameHeight) 
+  : Renderer(frameWidth, frameHeight),
+    m_programs("shaders/phong.vert", "shaders/phong.frag",
+               [this](GLuint _program) { setupProgram(_program); })
 {
   glEnable(GL_COLOR_MATERIAL);
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_BLEND); // blending for transparency
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  m_program = compileProgram("shaders/phong.vert", 
-                             "shaders/phong.frag");
-  glUseProgram(m_program);
+  // Composite of weighted blended transparency, drawn without vertex data
+  m_compositeProgram = compileProgram("shaders/fullscreen.vert",
+                                      "shaders/oit_composite.frag");
+  glUseProgram(m_compositeProgram);
+  glUniform1i(getUniformLocation(m_compositeProgram, "opaqueSampler"), 0);
+  glUniform1i(getUniformLocation(m_compositeProgram, "accumSampler"), 1);
+  glUniform1i(getUniformLocation(m_compositeProgram, "weightSampler"), 2);
+  glGenVertexArrays(1, &m_compositeVao);
+  m_stateCache.reset();
   glPointSize(3.0f);
+
+  glGenBuffers(1, &m_frameDataBuffer);
+  glGenBuffers(1, &m_objectDataBuffer);
+  m_frameData = FrameData{};
 }
 
 void
 Rasterizer::
-initScene(Scene& scene) {
+setupProgram(GLuint _program) {
+  // Bind uniform blocks to their binding points
+  glUniformBlockBinding(_program, 
+      glGetUniformBlockIndex(_program, "FrameData"), FRAME_DATA_BINDING);
+  glUniformBlockBinding(_program, 
+      glGetUniformBlockIndex(_program, "ObjectData"), OBJECT_DATA_BINDING);
+
   // Set up texture samplers
-  glUniform1i(getUniformLocation("kdTextureSampler"), 0);
-  glUniform1i(getUniformLocation("ksTextureSampler"), 1);
-  glUniform1i(getUniformLocation("keTextureSampler"), 2);
-  glUniform1i(getUniformLocation("normalTextureSampler"), 3);
-  glUniform1i(getUniformLocation("parallaxTextureSampler"), 4);
-
-  // Send lights
-  int i = 0;
+  glUseProgram(_program);
+  glUniform1i(getUniformLocation(_program, "kdTextureSampler"), 0);
+  glUniform1i(getUniformLocation(_program, "ksTextureSampler"), 1);
+  glUniform1i(getUniformLocation(_program, "keTextureSampler"), 2);
+  glUniform1i(getUniformLocation(_program, "normalTextureSampler"), 3);
+  glUniform1i(getUniformLocation(_program, "parallaxTextureSampler"), 4);
+  glUniform1i(getUniformLocation(_program, "lightDataSampler"), 
+              LIGHT_TEXTURE_UNIT);
+  glUniform1i(getUniformLocation(_program, "clusterSampler"), 
+              LIGHT_TEXTURE_UNIT + 1);
+  glUniform1i(getUniformLocation(_program, "lightIndexSampler"), 
+              LIGHT_TEXTURE_UNIT + 2);
+  // Program was bound directly
+  m_stateCache.reset();
+}
+
+Texture::Settings
+Rasterizer::
+getTextureSettings() const {
+  Texture::Settings settings;
+  settings.hasCpuCopy = false;
+  settings.hasCompression = m_hasCompressedTextures;
+  settings.hasS3tc = m_hasCompressedTextures && Texture::isS3tcSupported();
+  settings.hasTextureArrays = m_hasTextureArrays;
+  return settings;
+}
+
+void
+Rasterizer::
+initScene(Scene& scene) {
+  // Upload lights, their cluster lists are rebuilt every frame with the camera
+  std::vector<LightData> lights;
   for(auto& light : scene.lightSources()) {
-    // light uniform name has format 
-    //   lights[i].attribute
-    std::string prefix = "lights[" + std::to_string(i++) + "].";
-    LightUniformLocations uniformLocations {
-      getUniformLocation(prefix + "type"),
-      getUniformLocation(prefix + "pos"),
-      getUniformLocation(prefix + "dir"),
-      getUniformLocation(prefix + "cutoffDot"),
-      getUniformLocation(prefix + "ia"),
-      getUniformLocation(prefix + "id"),
-      getUniformLocation(prefix + "is"),
-      getUniformLocation(prefix + "al"),
-      getUniformLocation(prefix + "aa"),
-    };
-    light->sendLightData(uniformLocations);
-  }
-  glUniform1i(getUniformLocation("numLights"), i);
-  
-  // Save uniform locations for each object
-  ObjectUniformLocations objUniformLocs {
-    getUniformLocation("vertexModelMatrix"),
-    getUniformLocation("normalModelMatrix"),
-    getUniformLocation("hasTransparency"),
-    getUniformLocation("hasKdMap"),
-    getUniformLocation("hasKsMap"),
-    getUniformLocation("hasKeMap"),
-    getUniformLocation("hasNormalMap"),
-    getUniformLocation("hasParallaxMap"),
-    {
-      getUniformLocation("material.ka"),
-      getUniformLocation("material.kd"),
-      getUniformLocation("material.ks"),
-      getUniformLocation("material.ke"),
-      getUniformLocation("material.shininess"),
-      getUniformLocation("material.transparency")
+    if (lights.size() == MAX_LIGHTS) {
+      std::cerr << "Too many lights, only the first " << MAX_LIGHTS 
+        << " are rasterized" << std::endl;
+      break;
+    }
+    lights.push_back(light->getLightData());
+  }
+  m_lightClusters.setLights(lights, m_frameData);
+  m_lightClusters.bind(LIGHT_TEXTURE_UNIT);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_frameDataBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &m_frameData, GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, m_frameDataBuffer);
+
+  // Send meshes. Opaque objects with static meshes are appended to one shared
+  // vertex buffer so that they can be drawn together, the others get their
+  // own vertex array.
+  std::vector<RasterizableObject*> objs = scene.rasterizableObjects();
+  size_t vertexSize = m_hasCompactVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+  std::vector<char> sharedVertices;
+  std::vector<GLint> firstVertices(objs.size(), -1);
+  // Vertices each object appended, all its levels of detail
+  std::vector<GLint> nAppendedVertices(objs.size(), 0);
+  std::vector<ObjectData> objectData(objs.size());
+  std::vector<uint32_t> objectTextureSets(objs.size());
+  // Objects binding the same textures share a texture set id in their sort key
+  std::map<std::array<GLuint, RasterizableObject::N_TEXTURE_MAPS>, uint32_t> 
+      textureSets;
+  m_objectBounds.clear();
+  for(size_t j = 0; j < objs.size(); j++) {
+    if (objs[j]->isBatchable() && !objs[j]->hasTransparency()) {
+      firstVertices[j] = sharedVertices.size() / vertexSize;
+      objs[j]->appendMeshData(m_hasCompactVertices, sharedVertices);
+      nAppendedVertices[j] = sharedVertices.size() / vertexSize - firstVertices[j];
+    } else {
+      objs[j]->sendMeshData(m_hasCompactVertices);
+    }
+    objectData[j] = objs[j]->getObjectData();
+    // compile the program specialized for the object features up front
+    std::vector<std::string> defines = getShaderDefines(objectData[j].flags);
+    if (m_hasWeightedOit && objs[j]->hasTransparency()) {
+      defines.push_back("WEIGHTED_OIT 1");
     }
+    objs[j]->setProgram(m_programs.get(defines));
+    // the depth program runs the same vertex shader, so that the invariant
+    // positions of both passes match exactly
+    if (m_hasDepthPrepass && !objs[j]->hasTransparency() 
+        && !objs[j]->mayDiscardFragments()) {
+      defines.push_back("DEPTH_ONLY 1");
+      objs[j]->setDepthProgram(m_programs.get(defines));
+    }
+    objectTextureSets[j] = textureSets.emplace(
+        objs[j]->getTextureIds(), textureSets.size()).first->second;
+    // objects don't move, so their bounds are gathered once
+    m_objectBounds.push_back(objs[j]->getWorldBounds());
+  }
+
+  // Group objects drawn by one call. Shared vertex objects with the same
+  // flags and textures are batched, up to the size of the ObjectData array.
+  std::vector<std::vector<size_t>> groups;
+  std::vector<size_t> batchable;
+  for(size_t j = 0; j < objs.size(); j++) {
+    if (firstVertices[j] < 0) {
+      groups.push_back({j});
+    } else {
+      batchable.push_back(j);
+    }
+  }
+  auto batchOrder = [&](size_t a, size_t b) {
+    return std::make_pair(objectData[a].flags, objectTextureSets[a]) 
+         < std::make_pair(objectData[b].flags, objectTextureSets[b]);
   };
-  for(auto& obj : scene.rasterizableObjects()) {
-    obj->setUniformLocations(objUniformLocs);
-    obj->sendMeshData();
+  std::stable_sort(batchable.begin(), batchable.end(), batchOrder);
+  for(size_t i = 0; i < batchable.size(); i++) {
+    if (i == 0 || batchOrder(batchable[i-1], batchable[i]) 
+        || groups.back().size() == MAX_BATCH_OBJECTS) {
+      groups.emplace_back();
+    }
+    groups.back().push_back(batchable[i]);
   }
+
+  // Pack data of all groups into one uniform buffer, each aligned as required
+  // to bind them separately. Objects of a group are consecutive in the
+  // ObjectData array and know their index from a vertex attribute.
+  GLint alignment;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  std::vector<char> objectBuffer;
+  std::vector<GLint> batchIndices(sharedVertices.size() / vertexSize);
+  for(size_t g = 0; g < groups.size(); g++) {
+    size_t offset = (objectBuffer.size() + alignment - 1) / alignment * alignment;
+    objectBuffer.resize(offset + sizeof(ObjectData) * groups[g].size());
+    for(size_t i = 0; i < groups[g].size(); i++) {
+      size_t j = groups[g][i];
+      std::memcpy(&objectBuffer[offset + sizeof(ObjectData) * i], 
+                  &objectData[j], sizeof(ObjectData));
+      objs[j]->setObjectDataRange(m_objectDataBuffer, offset);
+      // The flags select the shader paths taken, so stand in for the variant
+      objs[j]->setStateKey(RenderQueue::makeStateKey(
+          objectData[j].flags, objectTextureSets[j], g + 1));
+      if (firstVertices[j] >= 0) {
+        std::fill_n(batchIndices.begin() + firstVertices[j], 
+                    nAppendedVertices[j], (GLint)i);
+      }
+    }
+  }
+  // every bound range spans the whole ObjectData array, even past the data
+  // of the last group
+  size_t lastOffset = groups.empty() ? 0 
+      : objectBuffer.size() - sizeof(ObjectData) * groups.back().size();
+  objectBuffer.resize(lastOffset + OBJECT_DATA_BLOCK_SIZE);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_objectDataBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, objectBuffer.size(), objectBuffer.data(), 
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  // Upload the shared vertices with their batch indices
+  if (!sharedVertices.empty()) {
+    glGenVertexArrays(1, &m_sharedVao);
+    glBindVertexArray(m_sharedVao);
+    glGenBuffers(1, &m_sharedVertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_sharedVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sharedVertices.size(), sharedVertices.data(), 
+                 GL_STATIC_DRAW);
+    RasterizableObject::setVertexAttributes(m_hasCompactVertices);
+    glGenBuffers(1, &m_batchIndexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_batchIndexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLint) * batchIndices.size(), 
+                 batchIndices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(RasterizableObject::BATCH_INDEX_LOCATION);
+    glVertexAttribIPointer(RasterizableObject::BATCH_INDEX_LOCATION, 
+                           1, GL_INT, 0, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    for(size_t j = 0; j < objs.size(); j++) {
+      if (firstVertices[j] >= 0) {
+        objs[j]->setSharedVertices(m_sharedVao, firstVertices[j]);
+      }
+    }
+  }
+  // Vertex arrays without the attribute read this value
+  glVertexAttribI1i(RasterizableObject::BATCH_INDEX_LOCATION, 0);
+
+  // Bindings above were done directly
+  m_stateCache.reset();
 }
 
 // Store an object and distance to camera, used for sorting
@@ -95,40 +272,228 @@ struct TransparentObject {
 void
 Rasterizer::
 render(const Scene& scene) {
-  glDepthMask(GL_TRUE);
+  // Report how many binds the state cache saved in the previous frame
+  if (m_hasStatsOutput) {
+    std::cout << "Binds: " << m_stateCache.getNumBinds() << " sent, " 
+      << m_stateCache.getNumSkippedBinds() << " skipped" << std::endl;
+  }
+  m_stateCache.resetStats();
+  // Upload streamed texture levels, binding textures behind the state cache
+  if (m_textureStreamer) {
+    m_textureStreamer->update();
+    m_stateCache.reset();
+  }
+  // Weighted blended transparency needs the opaque color and depth offscreen
+  if (m_hasWeightedOit) {
+    resizeOitTargets();
+    glBindFramebuffer(GL_FRAMEBUFFER, m_oitFramebuffer);
+    GLenum opaqueTarget = GL_COLOR_ATTACHMENT0;
+    glDrawBuffers(1, &opaqueTarget);
+  }
+  m_stateCache.setDepthState(GL_LESS, GL_TRUE);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   // Set up camera
   const Camera& camera = scene.getCamera();
   vec3 eye = camera.getEye();
-  glUniform3f(getUniformLocation("cameraPos"), eye.x, eye.y, eye.z);
   mat4 viewMatrix = glm::lookAt(eye, eye + camera.getAt(), camera.getUp());
   mat4 projMatrix = m_view->getProjectionMatrix();
-  glUniformMatrix4fv(
-      getUniformLocation("viewProjectionMatrix"), 
-      1, GL_FALSE, glm::value_ptr(projMatrix * viewMatrix));
+  // Update frame data and light clusters of the camera
+  m_frameData.cameraPos = eye;
+  m_frameData.viewProjectionMatrix = projMatrix * viewMatrix;
+  m_lightClusters.update(viewMatrix, projMatrix, m_view->getFrameWidth(), 
+                         m_view->getFrameHeight(), m_frameData);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_frameDataBuffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &m_frameData);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  // Cull objects outside the view
+  std::vector<RasterizableObject*> objs = scene.rasterizableObjects();
+  Frustum(m_frameData.viewProjectionMatrix).cull(m_objectBounds, m_objectVisible);
+  // Radius on screen, in pixels, of a unit sphere at unit distance for
+  // perspective views, or at any distance for orthographic views
+  float pixelsPerUnit = projMatrix[1][1] * m_view->getFrameHeight() / 2;
+  bool isPerspective = projMatrix[2][3] != 0;
   // Draw
   std::vector<TransparentObject> transparentObjs{};
-  // First render all opaque objects
-  for(auto& obj : scene.rasterizableObjects()) {
-    if (obj->hasTransparency()) {
+  m_opaqueQueue.clear();
+  m_transparentQueue.clear();
+  for(size_t i = 0; i < objs.size(); i++) {
+    if (!m_objectVisible[i]) {
+      continue;
+    }
+    RasterizableObject* obj = objs[i];
+    if (m_textureStreamer) {
+      for (GLuint texture : obj->getTextureIds()) {
+        m_textureStreamer->markUsed(texture);
+      }
+    }
+    vec3 pos = obj->getRoughPosition();
+    float dist = glm::length2(eye-pos);
+    if (obj->hasLods()) {
+      const BoundingSphere& bounds = obj->getWorldBounds();
+      float screenRadius = bounds.radius * pixelsPerUnit;
+      if (isPerspective) {
+        float d = glm::length(eye - bounds.center);
+        screenRadius = d > bounds.radius 
+            ? screenRadius / d : std::numeric_limits<float>::infinity();
+      }
+      obj->selectLod(screenRadius);
+    }
+    if (obj->hasTransparency() && m_hasWeightedOit) {
+      // blended in any order, so only sorted by state
+      m_transparentQueue.push(obj, obj->getStateKey(), dist);
+    } else if (obj->hasTransparency()) {
       // save transparent object for rendering later
-      vec3 pos = obj->getRoughPosition();
-      transparentObjs.emplace_back(glm::length2(eye-pos), obj);
+      transparentObjs.emplace_back(dist, obj);
     } else {
-      // draw opaque object
-      obj->draw();
+      m_opaqueQueue.push(obj, obj->getStateKey(), dist);
     }
   }
+  // First render all opaque objects, grouped by state
+  m_opaqueQueue.sort();
+  if (m_hasDepthPrepass) {
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    drawOpaqueQueue(true);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  }
+  drawOpaqueQueue(false);
+  if (m_hasWeightedOit) {
+    drawWeightedTransparency();
+    return;
+  }
   // Then render all transparent objects in sorted distance
-  glDepthMask(GL_FALSE);
+  m_stateCache.setDepthState(GL_LESS, GL_FALSE);
   std::sort(transparentObjs.begin(), transparentObjs.end());
   for(auto& tObj : transparentObjs) {
-    tObj.obj->draw();
+    m_stateCache.useProgram(tObj.obj->getProgram());
+    tObj.obj->draw(m_stateCache);
+  }
+}
+
+void
+Rasterizer::
+drawOpaqueQueue(bool _isDepthPrepass) {
+  auto item = m_opaqueQueue.begin();
+  while (item != m_opaqueQueue.end()) {
+    // Consecutive objects sharing their object data range are from the same
+    // batch, and are drawn in one call. They also share their flags, so
+    // whether they may discard.
+    RasterizableObject* obj = item->obj;
+    m_batchFirsts.clear();
+    m_batchCounts.clear();
+    for (; item != m_opaqueQueue.end() 
+           && item->obj->getObjectDataOffset() == obj->getObjectDataOffset(); 
+         ++item) {
+      m_batchFirsts.push_back(item->obj->getFirstVertex());
+      m_batchCounts.push_back(item->obj->getNumVertices());
+    }
+    // Objects with discarded fragments are left out of the pre-pass, and
+    // write their depth when shaded. The others are shaded only where their
+    // pre-pass depth survived.
+    bool isInPrepass = m_hasDepthPrepass && !obj->mayDiscardFragments();
+    if (_isDepthPrepass) {
+      if (!isInPrepass) {
+        continue;
+      }
+      m_stateCache.useProgram(obj->getDepthProgram());
+      m_stateCache.setDepthState(GL_LESS, GL_TRUE);
+    } else {
+      m_stateCache.useProgram(obj->getProgram());
+      if (isInPrepass) {
+        m_stateCache.setDepthState(GL_EQUAL, GL_FALSE);
+      } else {
+        m_stateCache.setDepthState(GL_LESS, GL_TRUE);
+      }
+    }
+    if (m_batchFirsts.size() == 1) {
+      obj->draw(m_stateCache);
+    } else {
+      obj->drawBatch(m_stateCache, m_batchFirsts, m_batchCounts);
+    }
+  }
+}
+
+void
+Rasterizer::
+resizeOitTargets() {
+  if (m_oitFramebuffer != 0 && m_oitWidth == m_width && m_oitHeight == m_height) {
+    return;
+  }
+  if (m_oitFramebuffer == 0) {
+    glGenFramebuffers(1, &m_oitFramebuffer);
+    glGenTextures(m_oitTextures.size(), m_oitTextures.data());
+  }
+  m_oitWidth = m_width;
+  m_oitHeight = m_height;
+
+  // Sums need the range of half floats, the opaque color and revealage don't
+  struct TargetFormat {
+    GLint internalFormat;
+    GLenum format;
+    GLenum type;
+    GLenum attachment;
+  };
+  static const TargetFormat TARGETS[] = {
+    {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0},
+    {GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT1},
+    {GL_R16F, GL_RED, GL_HALF_FLOAT, GL_COLOR_ATTACHMENT2},
+    {GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 
+     GL_DEPTH_ATTACHMENT},
+  };
+  glBindFramebuffer(GL_FRAMEBUFFER, m_oitFramebuffer);
+  for (size_t i = 0; i < m_oitTextures.size(); i++) {
+    const TargetFormat& target = TARGETS[i];
+    glBindTexture(GL_TEXTURE_2D, m_oitTextures[i]);
+    glTexImage2D(GL_TEXTURE_2D, 0, target.internalFormat, m_width, m_height, 
+                 0, target.format, target.type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, target.attachment, GL_TEXTURE_2D, 
+                           m_oitTextures[i], 0);
+  }
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "Incomplete framebuffer for order-independent transparency" 
+      << std::endl;
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  // Textures were bound directly
+  m_stateCache.reset();
+}
+
+void
+Rasterizer::
+drawWeightedTransparency() {
+  // Accumulate transparent fragments in front of the opaque depth, in any
+  // order: colors and weights are summed, revealage is multiplied by
+  // (1 - alpha) of each fragment
+  static const GLenum TARGETS[] = {GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+  static const GLfloat CLEAR_ACCUM[] = {0, 0, 0, 1};
+  static const GLfloat CLEAR_WEIGHT[] = {0, 0, 0, 0};
+  glDrawBuffers(2, TARGETS);
+  glClearBufferfv(GL_COLOR, 0, CLEAR_ACCUM);
+  glClearBufferfv(GL_COLOR, 1, CLEAR_WEIGHT);
+  m_stateCache.setDepthState(GL_LESS, GL_FALSE);
+  glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+  m_transparentQueue.sort();
+  for (auto& item : m_transparentQueue) {
+    m_stateCache.useProgram(item.obj->getProgram());
+    item.obj->draw(m_stateCache);
+  }
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  // Composite over the opaque color into the window
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  m_stateCache.setDepthState(GL_ALWAYS, GL_FALSE);
+  m_stateCache.useProgram(m_compositeProgram);
+  m_stateCache.bindVertexArray(m_compositeVao);
+  for (GLuint unit = 0; unit < 3; unit++) {
+    m_stateCache.bindTexture(unit, m_oitTextures[unit]);
   }
+  glDrawArrays(GL_TRIANGLES, 0, 3);
 }
 
 GLint
 Rasterizer::
-getUniformLocation(const std::string& uniformName) {
-  return glGetUniformLocation(m_program, uniformName.c_str());
+getUniformLocation(GLuint program, const std::string& uniformName) {
+  return glGetUniformLocation(program, uniformName.c_str());
 }
@@ -1,9 +1,19 @@
 #ifndef RASTERIZER_H_
 #define RASTERIZER_H_
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <vector>
 
+#include "CompileShaders.h"
+#include "Frustum.h"
+#include "LightClusters.h"
 #include "Renderer.h"
+#include "RenderQueue.h"
+#include "RenderStateCache.h"
+#include "TextureStreamer.h"
+#include "UniformBlocks.h"
 
 
 class Rasterizer : public Renderer
@@ -11,16 +21,107 @@ class Rasterizer : public Renderer
   public:
     Rasterizer(int frameWidth, int frameHeight);
 
+    ////////////////////////////////////////////////////////////////////////////
+    /// Textures are only uploaded to the GPU, compressed and packed into
+    /// arrays if enabled
+    Texture::Settings getTextureSettings() const override;
+
     void initScene(Scene& scene) override;
 
     void render(const Scene& scene) override;
 
+    ////////////////////////////////////////////////////////////////////////////
+    /// Use the quantized PackedVertex layout for meshes sent in initScene
+    void setCompactVertices(bool enabled) { m_hasCompactVertices = enabled; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Lay down the depth of opaque objects before shading them, so that each
+    /// pixel is shaded at most once
+    void setDepthPrepass(bool enabled) { m_hasDepthPrepass = enabled; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Render transparent objects in one unsorted pass with weighted blended
+    /// order-independent transparency, instead of sorting them by distance.
+    /// Must be set before initScene.
+    void setOrderIndependentTransparency(bool enabled) { m_hasWeightedOit = enabled; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Update the streamer of the scene textures each frame, telling it which
+    /// textures are drawn. It must outlive the rasterizer.
+    void setTextureStreamer(TextureStreamer* streamer) { m_textureStreamer = streamer; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Upload textures of scenes built afterwards as compressed blocks, see
+    /// Texture::Settings
+    void setCompressedTextures(bool enabled) { m_hasCompressedTextures = enabled; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Pack textures of scenes built afterwards into texture arrays, see
+    /// AssetManager
+    void setTextureArrays(bool enabled) { m_hasTextureArrays = enabled; }
+
   private:
-    GLuint m_program; ///< Shader program ID
+    ProgramCache m_programs; ///< Shading programs, specialized per object flags
+    bool m_hasCompactVertices{false}; ///< Upload meshes as PackedVertex
+    bool m_hasDepthPrepass{false}; ///< Render a depth pre-pass
+    bool m_hasWeightedOit{false}; ///< Weighted blended transparency
+    bool m_hasCompressedTextures{false}; ///< Upload compressed textures
+    bool m_hasTextureArrays{false}; ///< Pack textures into texture arrays
+    GLuint m_frameDataBuffer;  ///< Uniform buffer of FrameData
+    GLuint m_objectDataBuffer; ///< Uniform buffer of ObjectData of all objects
+    FrameData m_frameData;     ///< CPU copy of the frame data
+    LightClusters m_lightClusters; ///< Lights of each cluster of the view
+    /// First of the texture units of the light cluster buffers, after the
+    /// units of the object texture maps
+    static const GLuint LIGHT_TEXTURE_UNIT = 5;
+    RenderQueue m_opaqueQueue; ///< Opaque draws, sorted by state each frame
+    RenderStateCache m_stateCache; ///< Bindings done while drawing objects
+    /// World bounds of the scene objects, in the order of
+    /// Scene::rasterizableObjects
+    BoundingSphereArray m_objectBounds;
+    std::vector<uint8_t> m_objectVisible; ///< Culling result of each object
+    /// Vertex array of the meshes of all batchable objects
+    GLuint m_sharedVao{0};
+    GLuint m_sharedVertexBuffer{0};
+    /// Index of each shared vertex's object in its batch ObjectData array
+    GLuint m_batchIndexBuffer{0};
+    /// Vertex ranges of the batched draw being gathered
+    std::vector<GLint> m_batchFirsts;
+    std::vector<GLsizei> m_batchCounts;
+    /// Transparent draws in weighted blended mode, sorted by state only
+    RenderQueue m_transparentQueue;
+    /// Offscreen targets of weighted blended mode: opaque color, accumulated
+    /// weighted color with revealage in alpha, accumulated weight, and depth
+    GLuint m_oitFramebuffer{0};
+    std::array<GLuint, 4> m_oitTextures{};
+    int m_oitWidth{0};
+    int m_oitHeight{0};
+    GLuint m_compositeProgram; ///< Blends the targets onto the window
+    GLuint m_compositeVao;     ///< Empty vertex array of the composite draw
+    TextureStreamer* m_textureStreamer{nullptr}; ///< Null if not streaming
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Draw the opaque queue, merging draws of the same batch
+    /// @param _isDepthPrepass Draw for the depth pre-pass, skipping objects
+    ///                        that must be shaded to know their depth
+    void drawOpaqueQueue(bool _isDepthPrepass);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// (Re)create the weighted blended targets if the frame size changed
+    void resizeOitTargets();
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Accumulate the transparent queue into the weighted blended targets,
+    /// then composite them over the opaque color into the window
+    void drawWeightedTransparency();
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// Bind the uniform blocks and texture units of a new program
+    void setupProgram(GLuint program);
 
     ////////////////////////////////////////////////////////////////////////////
     /// Helper method to get uniform location from name
-    GLint getUniformLocation(const std::string& uniformName);
+    GLint getUniformLocation(GLuint program, const std::string& uniformName);
 };
 
 #endif // RASTERIZER_H_
\ No newline at end of file
@@ -6,9 +6,35 @@
 class Ray
 {
   public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Derivatives of a ray with respect to the pixel coordinates of
+    /// the ray cast from the camera, which give the footprint of the pixel
+    /// where the ray hits (Igehy 1999)
+    struct Differentials {
+      glm::vec3 dOdx{0, 0, 0}; ///< Derivatives of the origin
+      glm::vec3 dOdy{0, 0, 0};
+      glm::vec3 dDdx{0, 0, 0}; ///< Derivatives of the direction
+      glm::vec3 dDdy{0, 0, 0};
+    };
+
     Ray(glm::vec3 _origin, glm::vec3 _dir)
       : m_origin(_origin), m_dir(glm::normalize(_dir)) {};
 
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Create a ray with differentials
+    /// @param _diffs Differentials of the origin and of _dir, before _dir is
+    ///               normalized
+    Ray(glm::vec3 _origin, glm::vec3 _dir, const Differentials& _diffs)
+      : Ray(_origin, _dir)
+    {
+      // derivative of d/|d| is (dd - d * dot(d, dd) / |d|^2) / |d|
+      float length = glm::length(_dir);
+      m_diffs = _diffs;
+      m_diffs.dDdx = (_diffs.dDdx - m_dir * glm::dot(m_dir, _diffs.dDdx)) / length;
+      m_diffs.dDdy = (_diffs.dDdy - m_dir * glm::dot(m_dir, _diffs.dDdy)) / length;
+      m_hasDifferentials = true;
+    }
+
     glm::vec3 getOrigin() const {
       return m_origin;
     }
@@ -17,11 +43,74 @@ class Ray
       return m_dir;
     }
 
+    bool hasDifferentials() const {
+      return m_hasDifferentials;
+    }
+
+    const Differentials& getDifferentials() const {
+      return m_diffs;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Derivatives of the point where the ray hits a surface, in the
+    /// plane tangent to the surface. Zero if the ray has no differentials.
+    /// @param _t      Distance to the hit
+    /// @param _normal Normal of the surface at the hit, need not be unit
+    void getHitDifferentials(float _t, const glm::vec3& _normal,
+                             glm::vec3& _dPdx, glm::vec3& _dPdy) const {
+      _dPdx = m_diffs.dOdx + _t * m_diffs.dDdx;
+      _dPdy = m_diffs.dOdy + _t * m_diffs.dDdy;
+      // the hit slides along the ray to stay on the surface
+      float dDotN = glm::dot(m_dir, _normal);
+      if (dDotN != 0) {
+        _dPdx -= m_dir * (glm::dot(_dPdx, _normal) / dDotN);
+        _dPdy -= m_dir * (glm::dot(_dPdy, _normal) / dDotN);
+      }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Ray reflected by a surface, carrying the differentials over as
+    /// if the surface were flat around the hit
+    /// @param _t        Distance to the hit
+    /// @param _position Where the reflected ray starts, the hit unless the
+    ///                  surface moves it elsewhere like a portal does
+    /// @param _normal   Unit normal of the surface at the hit
+    Ray reflected(float _t, const glm::vec3& _position,
+                  const glm::vec3& _normal) const {
+      glm::vec3 dir = m_dir - 2.f * glm::dot(m_dir, _normal) * _normal;
+      if (!m_hasDifferentials) {
+        return Ray(_position, dir);
+      }
+      Differentials diffs;
+      getHitDifferentials(_t, _normal, diffs.dOdx, diffs.dOdy);
+      diffs.dDdx = m_diffs.dDdx - 2.f * glm::dot(m_diffs.dDdx, _normal) * _normal;
+      diffs.dDdy = m_diffs.dDdy - 2.f * glm::dot(m_diffs.dDdy, _normal) * _normal;
+      return Ray(_position, dir, diffs);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Ray in another space, e.g. the model space of an object
+    /// @param _transform Affine transform to the other space
+    Ray transformed(const glm::mat4& _transform) const {
+      glm::vec3 origin = glm::vec3(_transform * glm::vec4(m_origin, 1));
+      glm::mat3 linear = glm::mat3(_transform);
+      if (!m_hasDifferentials) {
+        return Ray(origin, linear * m_dir);
+      }
+      return Ray(origin, linear * m_dir, {
+        linear * m_diffs.dOdx, linear * m_diffs.dOdy,
+        linear * m_diffs.dDdx, linear * m_diffs.dDdy,
+      });
+    }
+
   private:
     /// Origin of the ray
     glm::vec3 m_origin;
     /// Unit vector specifying the direction of the ray
     glm::vec3 m_dir;
+    /// Differentials of the ray, all zero if it has none
+    Differentials m_diffs;
+    bool m_hasDifferentials{false};
 };
 
-#endif // RAY_H_
\ No newline at end of file
+#endif // RAY_H_
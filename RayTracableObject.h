@@ -1,13 +1,33 @@
 #ifndef RAYTRACABLE_OBJECT_H_
 #define RAYTRACABLE_OBJECT_H_
 
+#include <cstddef>
+
 #include "Ray.h"
 #include "RenderableObject.h"
 
+class RayTracableObject;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Where a ray hits an object, just enough to find the closest hit. The
+/// surface there is only evaluated for the closest one, see
+/// RayTracableObject::surfaceAt.
 struct RayHit {
   /// How far along the ray is the hit
   float t;
+  /// Barycentric coordinates of the hit in the hit triangle, as the weights of
+  /// its second and third vertices
+  glm::vec2 barycentric;
+  /// Which part of the object is hit, e.g. the first vertex of the triangle
+  size_t primitive;
+  const RayTracableObject* object;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Surface of an object at a ray hit
+struct SurfaceHit {
   glm::vec3 position;
+  /// Unit normal
   glm::vec3 normal;
   Material  material;
 };
@@ -24,6 +44,12 @@ class RayTracableObject : public RenderableObject
     /// the ray to the origin of the ray. A non-positive return value indicates
     /// that the object is not hit by the ray.
     virtual RayHit intersectRay(Ray _ray) const = 0;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Evaluate the surface where a ray hits the object
+    /// @param _ray Ray that was intersected
+    /// @param _hit Hit returned by intersectRay for the ray
+    virtual SurfaceHit surfaceAt(const Ray& _ray, const RayHit& _hit) const = 0;
 };
 
 #endif // RAYTRACABLE_OBJECT_H_
\ No newline at end of file
@@ -1,5 +1,11 @@
 #include "RayTracer.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
 RayTracer::
 RayTracer(int width, int height) 
   : Renderer(width, height)
@@ -18,56 +24,145 @@ setFrameSize(int width, int height) {
 void 
 RayTracer::
 render(const Scene& scene) {
-  int pixel = 0;
-  for (int j = 0; j < m_height; j++) {
-    for (int i = 0; i < m_width; i++) {
-      m_frame[pixel++] = renderPixel(scene, i, j);      
-    }
+  size_t nPixels = (size_t)m_width * m_height;
+  size_t batchPixels = std::max<size_t>(
+      RAY_BATCH_SIZE / ANTI_ALIAS_JITTERS[m_hasAntiAlias].size(), 1);
+  for (size_t first = 0; first < nPixels; first += batchPixels) {
+    renderPixels(scene, first, std::min(first + batchPixels, nPixels));
   }
   glDrawPixels(m_width, m_height, GL_RGBA, GL_FLOAT, m_frame.get());
 }
 
-glm::vec4
+void
 RayTracer::
-renderPixel(const Scene& scene, int i, int j) {
-  glm::vec3 color(0.f, 0.f, 0.f);
-  for (auto& jitter : ANTI_ALIAS_JITTERS[m_hasAntiAlias]) {
-    // cast ray
-    Ray ray = m_view->castRay(scene.getCamera(), i, j, jitter.x, jitter.y);
-    color += shade(scene, ray, MAX_RAY_RECURSION);
+renderPixels(const Scene& scene, size_t firstPixel, size_t lastPixel) {
+  // cast the primary rays, each weighing as one anti-aliasing sample
+  const std::vector<glm::vec2>& jitters = ANTI_ALIAS_JITTERS[m_hasAntiAlias];
+  glm::vec3 weight(1.f / jitters.size());
+  m_rays.clear();
+  m_rayPixels.clear();
+  m_rayWeights.clear();
+  for (size_t pixel = firstPixel; pixel < lastPixel; pixel++) {
+    int i = pixel % m_width;
+    int j = pixel / m_width;
+    for (auto& jitter : jitters) {
+      m_rays.push_back(m_view->castRay(scene.getCamera(), i, j, jitter.x, jitter.y));
+      m_rayPixels.push_back(pixel);
+      m_rayWeights.push_back(weight);
+    }
   }
-  color /= ANTI_ALIAS_JITTERS[m_hasAntiAlias].size();
-  return glm::vec4(color, 1);
-}
 
+  // black if nothing is hit by the rays
+  m_pixelColors.assign(lastPixel - firstPixel, glm::vec3(0, 0, 0));
+  for (int depth = 0; !m_rays.empty(); depth++) {
+    traceGeneration(scene, firstPixel, depth < MAX_RAY_RECURSION);
+  }
 
-glm::vec3
+  for (size_t pixel = firstPixel; pixel < lastPixel; pixel++) {
+    glm::vec3 color = m_pixelColors[pixel - firstPixel];
+    if (m_hasLinearTextures) {
+      for (int c = 0; c < 3; c++) {
+        color[c] = color[c] <= 0.0031308f 
+            ? 12.92f * color[c] 
+            : 1.055f * std::pow(color[c], 1 / 2.4f) - 0.055f;
+      }
+    }
+    m_frame[pixel] = glm::vec4(color, 1);
+  }
+}
+
+void
 RayTracer::
-shade(const Scene& scene, Ray ray, int maxRecursion) {
-  RayHit firstHit;
-  RayTracableObject* hitObj = scene.firstRayHit(ray, &firstHit);
-  if (!hitObj) {
-    // black if nothing is hit by the ray
-    return glm::vec4();
+traceGeneration(const Scene& scene, size_t firstPixel, bool canReflect) {
+  scene.firstRayHits(m_rays, m_hits);
+
+  // shade the hits object by object, so that consecutive surfaces read the
+  // same mesh and textures
+  m_hitOrder.clear();
+  for (size_t i = 0; i < m_rays.size(); i++) {
+    if (m_hits[i].object) {
+      m_hitOrder.push_back(i);
+    }
   }
-  Material material = firstHit.material;
-  // shade with Blinn-Phong
-  glm::vec3 color = shadeSurface(scene, firstHit.position, firstHit.normal, ray.getDirection(), material);
-  // add reflection for mirror-like material
-  if (maxRecursion > 0 && material.kr != glm::vec3(0, 0, 0)) {
-    glm::vec3 reflectDir = ray.getDirection() - 2.f * glm::dot(ray.getDirection(), firstHit.normal) * firstHit.normal;
-    Ray reflectRay(firstHit.position, reflectDir);
-    color += material.kr * shade(scene, reflectRay, maxRecursion - 1);
+  std::sort(m_hitOrder.begin(), m_hitOrder.end(), [this](size_t _a, size_t _b) {
+    const RayHit& a = m_hits[_a];
+    const RayHit& b = m_hits[_b];
+    return a.object != b.object ? std::less<>()(a.object, b.object) 
+                                : a.primitive < b.primitive;
+  });
+
+  m_surfaceColors.resize(m_rays.size());
+  m_shadowRays.clear();
+  m_shadowTests.clear();
+  m_nextRays.clear();
+  m_nextRayPixels.clear();
+  m_nextRayWeights.clear();
+  for (size_t i : m_hitOrder) {
+    const Ray& ray = m_rays[i];
+    // evaluate the surface only at the closest hit
+    SurfaceHit surface = m_hits[i].object->surfaceAt(ray, m_hits[i]);
+    const Material& material = surface.material;
+    // shade with Blinn-Phong
+    m_surfaceColors[i] = shadeSurface(scene, surface.position, surface.normal, 
+                                      ray.getDirection(), material, i);
+    // add reflection for mirror-like material
+    if (canReflect && material.kr != glm::vec3(0, 0, 0)) {
+      m_nextRays.push_back(
+          ray.reflected(m_hits[i].t, surface.position, surface.normal));
+      m_nextRayPixels.push_back(m_rayPixels[i]);
+      m_nextRayWeights.push_back(m_rayWeights[i] * material.kr);
+    }
   }
-  return color;
+
+  // if blocked by other objects, the light doesn't add anything
+  scene.firstRayHits(m_shadowRays, m_hits);
+  for (size_t s = 0; s < m_shadowTests.size(); s++) {
+    const ShadowTest& test = m_shadowTests[s];
+    if (!m_hits[s].object || m_hits[s].t >= test.distance) {
+      m_surfaceColors[test.ray] += test.contribution;
+    }
+  }
+
+  for (size_t i : m_hitOrder) {
+    // make sure color doesn't exceed 1
+    m_pixelColors[m_rayPixels[i] - firstPixel] += 
+        m_rayWeights[i] * glm::min(m_surfaceColors[i], glm::vec3(1, 1, 1));
+  }
+
+  std::swap(m_rays, m_nextRays);
+  std::swap(m_rayPixels, m_nextRayPixels);
+  std::swap(m_rayWeights, m_nextRayWeights);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @return Pseudo random number in [0, 1) hashed from a point, the same for
+/// the same point so that sampled lights don't flicker from frame to frame
+static float
+hashToUnit(glm::vec3 _pos) {
+  uint32_t hash = 0x9E3779B9u;
+  for (int i = 0; i < 3; i++) {
+    uint32_t bits;
+    std::memcpy(&bits, &_pos[i], sizeof(bits));
+    // murmur3 finalizer
+    hash ^= bits;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+  }
+  return (hash >> 8) * (1.f / (1u << 24));
 }
 
 glm::vec3
 RayTracer::
-shadeSurface(const Scene& scene, glm::vec3 pos, glm::vec3 normal, glm::vec3 viewDir, const Material& material) {
+shadeSurface(const Scene& scene, glm::vec3 pos, glm::vec3 normal, glm::vec3 viewDir, const Material& material, size_t ray) {
   glm::vec3 color = material.ke; // object can emit light from surface
 
-  // for each light source, add the ambient, diffuse and specular lighting
+  // Ambient light from every light, then the diffuse and specular light each
+  // would add if not shadowed, skipping those too dim to be worth a shadow ray
+  m_litLights.clear();
+  float totalWeight = 0;
   for (auto& lightSource : scene.lightSources()) {
     LightRay light = lightSource->getLightRay(pos);
     // ambient light
@@ -76,21 +171,46 @@ shadeSurface(const Scene& scene, glm::vec3 pos, glm::vec3 normal, glm::vec3 view
     if (light.direction == glm::vec3(0, 0, 0)) {
       continue;
     }
-    // if blocked by other objects, continue on
-    Ray towardLight(pos, -light.direction);
-    RayHit hitInfo;
-    if (scene.firstRayHit(towardLight, &hitInfo)) {
-      if (hitInfo.t < light.distance) {
-        continue;
-      }
-    }
     // diffuse
-    color += material.kd * light.intensityDiffuse 
+    glm::vec3 contribution = material.kd * light.intensityDiffuse 
         * std::max(0.f, -glm::dot(normal, light.direction));
     // specular
     glm::vec3 halfVec = -glm::normalize(viewDir + light.direction);
-    color += material.ks * light.intensitySpecular
+    contribution += material.ks * light.intensitySpecular
         * std::pow(std::max(0.f, glm::dot(normal, halfVec)), material.shininess);
+    if (std::max({contribution.x, contribution.y, contribution.z}) 
+        < MIN_LIGHT_CONTRIBUTION) {
+      continue;
+    }
+    totalWeight += contribution.x + contribution.y + contribution.z;
+    m_litLights.push_back({light.direction, light.distance, contribution, 
+                           totalWeight});
+  }
+
+  // queue a shadow ray toward the light, traced with those of other hits
+  auto castShadowRay = [&](const LitLight& _light, glm::vec3 _contribution) {
+    m_shadowRays.emplace_back(pos, -_light.direction);
+    m_shadowTests.push_back({ray, _light.distance, _contribution});
+  };
+  if (m_litLights.size() <= MAX_SHADOW_RAYS) {
+    for (const LitLight& light : m_litLights) {
+      castShadowRay(light, light.contribution);
+    }
+  } else {
+    // Sample lights in proportion to their contribution, stratified over the
+    // cumulative weights. Dividing by the expected number of samples of a
+    // light keeps the sum unbiased.
+    float offset = hashToUnit(pos);
+    for (size_t s = 0; s < MAX_SHADOW_RAYS; s++) {
+      float target = (s + offset) / MAX_SHADOW_RAYS * totalWeight;
+      auto light = std::upper_bound(m_litLights.begin(), m_litLights.end() - 1, 
+          target, [](float _target, const LitLight& _light) {
+            return _target < _light.cumulativeWeight;
+          });
+      const glm::vec3& c = light->contribution;
+      float expectedSamples = MAX_SHADOW_RAYS * (c.x + c.y + c.z) / totalWeight;
+      castShadowRay(*light, c / expectedSamples);
+    }
   }
-  return glm::min(color, glm::vec3(1, 1, 1)); // make sure color doesn't exceed 1
+  return color;
 }
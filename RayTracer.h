@@ -19,6 +19,16 @@ class RayTracer : public Renderer
 
     void setFrameSize(int width, int height) override;
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /// @brief Textures are only kept in CPU memory, and decoded to linear if
+    /// enabled with setLinearTextures
+    Texture::Settings getTextureSettings() const override {
+      Texture::Settings settings;
+      settings.hasGpuUpload = false;
+      settings.hasLinearStorage = m_hasLinearTextures;
+      return settings;
+    }
+
     void initScene(Scene& scene) override {};
 
     ////////////////////////////////////////////////////////////////////////////////
@@ -26,10 +36,68 @@ class RayTracer : public Renderer
     /// buffer.
     void render(const Scene& scene) override;
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /// @brief Shade in linear space: textures, material colors and light colors
+    /// of scenes built afterwards are decoded to linear at load, and the shaded
+    /// colors are encoded to sRGB before display
+    void setLinearTextures(bool enabled) { m_hasLinearTextures = enabled; }
+
   private:
     std::unique_ptr<glm::vec4[]> m_frame{nullptr}; ///< Framebuffer
+    bool m_hasLinearTextures{false}; ///< Shading is linear, display is sRGB
     
     const int MAX_RAY_RECURSION = 5;
+    /// Max rays traced together. Pixels are rendered in batches whose primary
+    /// rays fit this, then all their reflections, and so on.
+    const size_t RAY_BATCH_SIZE = 1 << 14;
+
+    /// Lights whose unshadowed light on a point stays below this in every
+    /// channel, i.e. under one 8-bit color step, are skipped without casting a
+    /// shadow ray
+    const float MIN_LIGHT_CONTRIBUTION = 1.f / 256;
+    /// Max shadow rays per hit. Points lit by more lights cast this many
+    /// toward lights sampled in proportion to their contribution.
+    const size_t MAX_SHADOW_RAYS = 8;
+
+    /// Light reaching a point being shaded, if not shadowed
+    struct LitLight {
+      glm::vec3 direction;    ///< From the light to the point
+      float distance;
+      glm::vec3 contribution; ///< Diffuse and specular color it adds
+      float cumulativeWeight; ///< Sum of the weights of lights up to this one
+    };
+    /// Lights of the point being shaded, kept to reuse their memory
+    std::vector<LitLight> m_litLights;
+
+    /// Light a shadow ray is cast toward, added to the surface if not blocked
+    struct ShadowTest {
+      size_t ray;             ///< Ray whose hit casts the shadow ray
+      float distance;         ///< Distance to the light
+      glm::vec3 contribution; ///< Color the light adds to the surface
+    };
+
+    // Batches of the wavefront, kept between frames to reuse their memory
+    /// Rays of the current generation, with the pixel each ray adds to and
+    /// the weight of its color in the pixel
+    std::vector<Ray> m_rays;
+    std::vector<size_t> m_rayPixels;
+    std::vector<glm::vec3> m_rayWeights;
+    /// Rays of the next generation, in the same layout
+    std::vector<Ray> m_nextRays;
+    std::vector<size_t> m_nextRayPixels;
+    std::vector<glm::vec3> m_nextRayWeights;
+    /// First hit of each ray, then of each shadow ray
+    std::vector<RayHit> m_hits;
+    /// Rays hitting something, sorted by object and primitive hit
+    std::vector<size_t> m_hitOrder;
+    /// Color of the surface hit by each ray, lights are added once their
+    /// shadow rays are traced
+    std::vector<glm::vec3> m_surfaceColors;
+    /// Shadow rays of the current generation
+    std::vector<Ray> m_shadowRays;
+    std::vector<ShadowTest> m_shadowTests;
+    /// Color of the pixels of the batch
+    std::vector<glm::vec3> m_pixelColors;
 
     const std::vector<std::vector<glm::vec2>> ANTI_ALIAS_JITTERS {
       {
@@ -44,21 +112,25 @@ class RayTracer : public Renderer
     };
 
     ////////////////////////////////////////////////////////////////////////////////
-    /// @brief Ray trace to find the color of a pixel
-    /// @param i Pixel index along the X axis
-    /// @param j Pixel index along the Y axis
-    /// @return RGBA color encoded in a vec4
-    glm::vec4 renderPixel(const Scene& scene, int i, int j);
+    /// @brief Ray trace a batch of pixels into the framebuffer, one generation
+    /// of rays at a time
+    /// @param firstPixel Index of the first pixel, row by row
+    /// @param lastPixel  Index past the last pixel
+    void renderPixels(const Scene& scene, size_t firstPixel, size_t lastPixel);
 
     ////////////////////////////////////////////////////////////////////////////////
-    /// @brief Shader function to compute color on an object using Blinn-Phong
-    /// shading algorithm and ideal specular reflection 
-    glm::vec3 shade(const Scene& scene, Ray ray, int maxRecursion);
+    /// @brief Trace the rays of the current generation, add their shaded color
+    /// to the pixels, and make the reflected rays the next generation
+    /// @param firstPixel    Index of the first pixel of the batch
+    /// @param canReflect Whether the rays may be reflected further
+    void traceGeneration(const Scene& scene, size_t firstPixel, bool canReflect);
 
     ////////////////////////////////////////////////////////////////////////////////
     /// @brief Shader function to compute color on an object using Blinn-Phong
-    /// shading algorithm
-    glm::vec3 shadeSurface(const Scene& scene, glm::vec3 pos, glm::vec3 normal, glm::vec3 viewDir, const Material& material);
+    /// shading algorithm. Only the emitted and ambient light is returned, the
+    /// diffuse and specular light of each light is queued behind a shadow ray.
+    /// @param ray Index of the ray hitting the surface
+    glm::vec3 shadeSurface(const Scene& scene, glm::vec3 pos, glm::vec3 normal, glm::vec3 viewDir, const Material& material, size_t ray);
 };
 
 #endif // RAY_TRACER_H_
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+uint64_t
+RenderQueue::
+makeStateKey(uint32_t _shaderVariant, uint32_t _textureSet, 
+             uint32_t _geometry) {
+  return ((uint64_t)(_shaderVariant & ((1u << SHADER_VARIANT_BITS) - 1)) << 52)
+       | ((uint64_t)(_textureSet & 0xffff) << 36)
+       | ((uint64_t)(_geometry & 0xffff) << 20);
+}
+
+void
+RenderQueue::
+push(RasterizableObject* _obj, uint64_t _stateKey, float _depth) {
+  // bits of a non-negative float sort in the same order as the float, keep
+  // the 20 most significant ones
+  uint32_t depthBits;
+  std::memcpy(&depthBits, &_depth, sizeof(float));
+  m_items.push_back({_stateKey | (depthBits >> 12), _obj});
+}
+
+void
+RenderQueue::
+sort() {
+  std::sort(m_items.begin(), m_items.end());
+}
@@ -0,0 +1,65 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include <cstdint>
+#include <vector>
+
+class RasterizableObject;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief List of draws for a frame, sorted to minimize state changes.
+///
+/// Each draw is sorted by a 64-bit key, from the most to least significant bits:
+///   - 44 bits of object state (see makeStateKey), so draws sharing a shader
+///     variant, texture set and geometry are next to each other
+///   - 20 bits of depth, so draws with the same state go front to back
+class RenderQueue
+{
+  public:
+    /// Bits of the shader variant in the sort key
+    static const int SHADER_VARIANT_BITS = 12;
+
+    /// A draw with its sort key
+    struct DrawItem {
+      uint64_t key;
+      RasterizableObject* obj;
+
+      bool operator<(const DrawItem& other) const { return key < other.key; }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Make the state part of a sort key
+    /// @param _shaderVariant Identifier of the shader variant,
+    ///                       SHADER_VARIANT_BITS bits
+    /// @param _textureSet    Identifier of the set of bound textures, 16 bits
+    /// @param _geometry      Identifier of the bound vertex array and object
+    ///                       data range, 16 bits. Draws with the same state key
+    ///                       can be merged into one call.
+    static uint64_t makeStateKey(uint32_t _shaderVariant,
+                                 uint32_t _textureSet,
+                                 uint32_t _geometry);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Remove all draws, keeping the allocated memory
+    void clear() { m_items.clear(); }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Add a draw
+    /// @param _obj      Object to draw
+    /// @param _stateKey State part of the sort key, from makeStateKey
+    /// @param _depth    Non-negative distance (or any monotonic function of it)
+    ///                  from the camera
+    void push(RasterizableObject* _obj, uint64_t _stateKey, float _depth);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Sort the draws by their keys
+    void sort();
+
+    std::vector<DrawItem>::const_iterator begin() const { return m_items.begin(); }
+    std::vector<DrawItem>::const_iterator end() const { return m_items.end(); }
+
+  private:
+    std::vector<DrawItem> m_items;
+};
+
+#endif // RENDER_QUEUE_H_
@@ -0,0 +1,78 @@
+#include "RenderStateCache.h"
+
+void
+RenderStateCache::
+reset() {
+  m_program = UNKNOWN;
+  m_vao = UNKNOWN;
+  m_activeUnit = UNKNOWN;
+  m_textures.fill(UNKNOWN);
+  m_uniformRanges.fill({UNKNOWN, 0, 0});
+  m_depthFunc = UNKNOWN;
+  m_depthWrite = UNKNOWN;
+}
+
+void
+RenderStateCache::
+useProgram(GLuint _program) {
+  if (update(m_program, _program)) {
+    glUseProgram(_program);
+  }
+}
+
+void
+RenderStateCache::
+bindVertexArray(GLuint _vao) {
+  if (update(m_vao, _vao)) {
+    glBindVertexArray(_vao);
+  }
+}
+
+void
+RenderStateCache::
+bindTexture(GLuint _unit, GLuint _texture, GLenum _target) {
+  if (_unit >= N_TEXTURE_UNITS) {
+    // not tracked
+    glActiveTexture(GL_TEXTURE0 + _unit);
+    glBindTexture(_target, _texture);
+    m_activeUnit = _unit;
+    return;
+  }
+  if (update(m_textures[_unit], _texture)) {
+    // only switch active unit when actually binding
+    if (m_activeUnit != _unit) {
+      glActiveTexture(GL_TEXTURE0 + _unit);
+      m_activeUnit = _unit;
+    }
+    glBindTexture(_target, _texture);
+  }
+}
+
+void
+RenderStateCache::
+bindUniformBufferRange(GLuint _binding, GLuint _buffer,
+                       GLintptr _offset, GLsizeiptr _size) {
+  if (_binding >= m_uniformRanges.size()) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, _binding, _buffer, _offset, _size);
+    return;
+  }
+  UniformRange& range = m_uniformRanges[_binding];
+  if (range.buffer == _buffer && range.offset == _offset && range.size == _size) {
+    m_nSkippedBinds++;
+    return;
+  }
+  range = {_buffer, _offset, _size};
+  m_nBinds++;
+  glBindBufferRange(GL_UNIFORM_BUFFER, _binding, _buffer, _offset, _size);
+}
+
+void
+RenderStateCache::
+setDepthState(GLenum _func, GLboolean _write) {
+  if (update(m_depthFunc, _func)) {
+    glDepthFunc(_func);
+  }
+  if (update(m_depthWrite, (GLuint)_write)) {
+    glDepthMask(_write);
+  }
+}
\ No newline at end of file
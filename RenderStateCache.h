@@ -0,0 +1,90 @@
+#ifndef RENDER_STATE_CACHE_H_
+#define RENDER_STATE_CACHE_H_
+
+#include <array>
+#include <cstddef>
+
+#include "GLInclude.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Shadow copy of the GL bindings changed while drawing objects, so that
+/// binding what is already bound doesn't reach the driver.
+///
+/// Only valid as long as all binds of the tracked state go through the cache.
+/// Call reset after binding anything directly.
+class RenderStateCache
+{
+  public:
+    /// Number of texture units tracked
+    static const int N_TEXTURE_UNITS = 8;
+
+    RenderStateCache() { reset(); }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Forget the tracked state, so the next binds always go through
+    void reset();
+
+    void useProgram(GLuint _program);
+
+    void bindVertexArray(GLuint _vao);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Bind a texture to a texture unit
+    /// @param _unit    Index of texture unit, from 0
+    /// @param _texture Texture name
+    /// @param _target  Target of the texture. Names are tracked per unit
+    ///                 whatever their target, as a name has a single target.
+    void bindTexture(GLuint _unit, GLuint _texture, 
+                     GLenum _target = GL_TEXTURE_2D);
+
+    void bindUniformBufferRange(GLuint _binding, GLuint _buffer,
+                                GLintptr _offset, GLsizeiptr _size);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Set the depth test function and whether depth is written
+    void setDepthState(GLenum _func, GLboolean _write);
+
+    /// Number of binds sent to GL and skipped since the last resetStats
+    size_t getNumBinds() const { return m_nBinds; }
+    size_t getNumSkippedBinds() const { return m_nSkippedBinds; }
+
+    void resetStats() { m_nBinds = m_nSkippedBinds = 0; }
+
+  private:
+    /// Value that never matches a real GL name, forcing the next bind
+    static const GLuint UNKNOWN = ~0u;
+
+    /// Range bound to a uniform buffer binding point
+    struct UniformRange {
+      GLuint buffer;
+      GLintptr offset;
+      GLsizeiptr size;
+    };
+
+    GLuint m_program;
+    GLuint m_vao;
+    GLuint m_activeUnit;
+    std::array<GLuint, N_TEXTURE_UNITS> m_textures;
+    std::array<UniformRange, 4> m_uniformRanges;
+    GLenum m_depthFunc;
+    GLuint m_depthWrite; ///< GLboolean, or UNKNOWN
+
+    size_t m_nBinds{0};
+    size_t m_nSkippedBinds{0};
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Update a tracked value and count the bind
+    /// @return Whether the value changed, i.e. the bind must be sent to GL
+    template<typename T>
+    bool update(T& _current, const T& _value) {
+      if (_current == _value) {
+        m_nSkippedBinds++;
+        return false;
+      }
+      _current = _value;
+      m_nBinds++;
+      return true;
+    }
+};
+
+#endif // RENDER_STATE_CACHE_H_
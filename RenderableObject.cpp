@@ -1,25 +1,46 @@
 #include "RenderableObject.h"
 
-#include <utility>
+#include <stdexcept>
+
+/// Shared placeholder for objects without a texture map
+static const std::shared_ptr<const Texture> NO_TEXTURE =
+    std::make_shared<const Texture>();
 
 RenderableObject::
 RenderableObject(const MaterialConfig& _config)
-  : m_defaultMaterial(_config.defaultMaterial),
-    m_hasTransparency(_config.hasTransparency)
-{
-  if (_config.hasKdMap) {
-    m_kdTexture = std::move(Texture(_config.kdTextureFile));
-  }
-  if (_config.hasKsMap) {
-    m_ksTexture = std::move(Texture(_config.ksTextureFile));
-  }
-  if (_config.hasKeMap) {
-    m_keTexture = std::move(Texture(_config.keTextureFile));
-  }
-  if (_config.hasNormalMap) {
-    m_normalTexture = std::move(Texture(_config.normalTextureFile));
+  : m_hasTransparency(_config.hasTransparency),
+    m_kdTexture(resolveTexture(
+        _config.hasKdMap, _config.kdTexture)),
+    m_ksTexture(resolveTexture(
+        _config.hasKsMap, _config.ksTexture)),
+    m_keTexture(resolveTexture(
+        _config.hasKeMap, _config.keTexture)),
+    m_normalTexture(resolveTexture(
+        _config.hasNormalMap, _config.normalTexture)),
+    m_parallaxTexture(resolveTexture(
+        _config.hasParallaxMap, _config.parallaxTexture)),
+    m_defaultMaterial(_config.defaultMaterial)
+{}
+
+RenderableObject::
+RenderableObject(const Material& _material)
+  : m_hasTransparency(false),
+    m_kdTexture(NO_TEXTURE),
+    m_ksTexture(NO_TEXTURE),
+    m_keTexture(NO_TEXTURE),
+    m_normalTexture(NO_TEXTURE),
+    m_parallaxTexture(NO_TEXTURE),
+    m_defaultMaterial(_material)
+{}
+
+std::shared_ptr<const Texture>
+RenderableObject::
+resolveTexture(bool _hasMap, const std::shared_ptr<const Texture>& _texture) {
+  if (!_hasMap) {
+    return NO_TEXTURE;
   }
-  if (_config.hasParallaxMap) {
-    m_parallaxTexture = std::move(Texture(_config.parallaxTextureFile));
+  if (!_texture) {
+    throw std::invalid_argument("Texture map not loaded by the asset manager");
   }
-}    
+  return _texture;
+}
@@ -1,6 +1,8 @@
 #ifndef RENDERABLE_OBJECT_H_
 #define RENDERABLE_OBJECT_H_
 
+#include <memory>
+
 #include "Material.h"
 #include "Texture.h"
 
@@ -13,7 +15,7 @@ class RenderableObject
 
     ////////////////////////////////////////////////////////////////////////////
     /// @brief Create an object with a simple material
-    RenderableObject(const Material& _material) : m_defaultMaterial(_material) {};
+    RenderableObject(const Material& _material);
     
     ////////////////////////////////////////////////////////////////////////////
     /// @brief Update object between frames
@@ -31,13 +33,24 @@ class RenderableObject
     // all objects
 
   protected:
+    /// Textures may be shared with other objects. They are never null, an
+    /// object without a texture map holds an invalid texture.
     bool     m_hasTransparency;
-    Texture  m_kdTexture;
-    Texture  m_ksTexture;
-    Texture  m_keTexture;
-    Texture  m_normalTexture;
-    Texture  m_parallaxTexture;
+    std::shared_ptr<const Texture> m_kdTexture;
+    std::shared_ptr<const Texture> m_ksTexture;
+    std::shared_ptr<const Texture> m_keTexture;
+    std::shared_ptr<const Texture> m_normalTexture;
+    std::shared_ptr<const Texture> m_parallaxTexture;
     Material m_defaultMaterial;
+
+  private:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Use the texture loaded by the asset manager if the map is
+    /// enabled, the shared empty texture otherwise. Throws if the map is
+    /// enabled but its texture was not loaded.
+    static std::shared_ptr<const Texture> resolveTexture(
+        bool _hasMap,
+        const std::shared_ptr<const Texture>& _texture);
 };
 
 #endif // RENDERABLE_OBJECT_H_
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "OrthographicView.h"
 #include "PerspectiveView.h"
 #include "Scene.h"
+#include "Texture.h"
 #include "View.h"
 
 class Renderer
@@ -42,8 +43,19 @@ class Renderer
       m_hasAntiAlias = enabled;
     }
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /// @brief Print statistics of each frame, for renderers that gather any
+    void setStatsOutput(bool enabled) { m_hasStatsOutput = enabled; }
+
     bool isPerspectiveView() const { return m_isPerspectiveView; }
     bool hasAntiAlias() const { return m_hasAntiAlias; }
+    bool hasStatsOutput() const { return m_hasStatsOutput; }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    /// @brief Where and how the textures of the scene must be stored for this
+    /// renderer to sample them. Must be called on the thread owning the GL
+    /// context.
+    virtual Texture::Settings getTextureSettings() const = 0;
 
     virtual void initScene(Scene& scene) = 0;
 
@@ -65,6 +77,7 @@ class Renderer
     const float ORTHO_VIEW_PLANE_HEIGHT{5.f};
 
     bool m_hasAntiAlias;
+    bool m_hasStatsOutput{false};
 };
 
 #endif // RENDERER_H_
\ No newline at end of file
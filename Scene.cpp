@@ -16,26 +16,25 @@ addLightSource(std::unique_ptr<LightSource> _light) {
   m_lights.push_back(std::move(_light));
 }
 
-RayTracableObject*
+void
 Scene::
-firstRayHit(Ray _ray, RayHit* _hitInfo) const {
-  RayHit firstHit;
-  firstHit.t = std::numeric_limits<float>::infinity();
-  RayTracableObject* firstObj = nullptr;
+firstRayHits(const std::vector<Ray>& _rays, std::vector<RayHit>& _hits) const {
+  RayHit noHit{std::numeric_limits<float>::infinity(), {0, 0}, 0, nullptr};
+  _hits.assign(_rays.size(), noHit);
   for(auto& renderableObj : m_objects) {
     RayTracableObject* obj = dynamic_cast<RayTracableObject*>(renderableObj.get());
     if (obj == nullptr) {
       // object is not ray-tracable
       continue;
     }
-    RayHit hit = obj->intersectRay(_ray);
-    if (hit.t > SELF_INTERSECTION_BIAS && hit.t < firstHit.t) {
-      firstHit = hit;
-      firstObj = obj;
+    for (size_t i = 0; i < _rays.size(); i++) {
+      RayHit hit = obj->intersectRay(_rays[i]);
+      if (hit.t > SELF_INTERSECTION_BIAS && hit.t < _hits[i].t) {
+        _hits[i] = hit;
+        _hits[i].object = obj;
+      }
     }
   }
-  *_hitInfo = firstHit;
-  return firstObj;
 }
 
 std::vector<LightSource*>
@@ -27,12 +27,14 @@ class Scene
     void addLightSource(std::unique_ptr<LightSource> _light);
 
     ////////////////////////////////////////////////////////////////////////////
-    /// @brief Find the first object hit by the given ray
-    /// @param[in]  _ray     The ray to cast
-    /// @param[out] _hitInfo Address of a struct to store the hit info
-    /// @return     The pointer to the first object hit by the ray, or nullptr
-    ///             if no object is hit.
-    RayTracableObject* firstRayHit(Ray _ray, RayHit* _hitInfo) const;
+    /// @brief Find the first hit of each ray of a batch. Objects are tested
+    /// one by one against the whole batch, so that each object's data is read
+    /// once instead of once per ray.
+    /// @param[in]  _rays The rays to cast
+    /// @param[out] _hits The first hit of each ray, with a null object if the
+    ///                   ray hits nothing
+    void firstRayHits(const std::vector<Ray>& _rays,
+                      std::vector<RayHit>& _hits) const;
 
     ////////////////////////////////////////////////////////////////////////////
     /// @brief Provide an iterable of light sources
@@ -17,6 +17,7 @@
 // scene objects
 #include "BezierSurface.h"
 #include "Circle.h"
+#include "InstancedObject.h"
 #include "Plane.h"
 #include "Portal.h"
 #include "RasterizableObject.h"
@@ -62,28 +63,53 @@ getTransform(const Json& j) {
 
 void
 from_json(const Json& j, MaterialConfig& mc) {
+  // inline material definition, material files are loaded by the AssetManager
+  Material m = {}; 
+  m.ka = getVec3(j.at("k_a"));
+  m.kd = getVec3(j.at("k_d"));
+  m.ks = getVec3(j.at("k_s"));
+  if (j.find("k_r") != j.end()) {
+    m.kr = getVec3(j.at("k_r"));
+  }
+  if (j.find("k_e") != j.end()) {
+    m.ke = getVec3(j.at("k_e"));
+  }
+  j.at("shininess").get_to(m.shininess);
+  if (j.find("transparency") != j.end()) {
+    j.at("transparency").get_to(m.transparency);
+    mc.hasTransparency = m.transparency < 1.f;
+  }
+  mc.defaultMaterial = m;
+  mc.hasKdMap = mc.hasKsMap = mc.hasKeMap = false;
+}
+
+MaterialConfig
+SceneBuilder::
+getMaterialConfig(const Json& j) {
+  MaterialConfig config;
   if (j.is_string()) {
-    // name of material file
-    mc = parseMaterialFile(j.get<string>());
+    // name of material file, shared with other objects using it
+    config = *m_assets.getMaterial(j.get<string>());
   } else {
-    Material m = {}; 
-    m.ka = getVec3(j.at("k_a"));
-    m.kd = getVec3(j.at("k_d"));
-    m.ks = getVec3(j.at("k_s"));
-    if (j.find("k_r") != j.end()) {
-      m.kr = getVec3(j.at("k_r"));
-    }
-    if (j.find("k_e") != j.end()) {
-      m.ke = getVec3(j.at("k_e"));
-    }
-    j.at("shininess").get_to(m.shininess);
-    if (j.find("transparency") != j.end()) {
-      j.at("transparency").get_to(m.transparency);
-      mc.hasTransparency = m.transparency < 1.f;
-    }
-    mc.defaultMaterial = m;
-    mc.hasKdMap = mc.hasKsMap = mc.hasKeMap = false;
+    config = j.get<MaterialConfig>();
   }
+  // kr and transparency are ratios rather than colors, kept as they are
+  Material& m = config.defaultMaterial;
+  m.ka = getColor(m.ka);
+  m.kd = getColor(m.kd);
+  m.ks = getColor(m.ks);
+  m.ke = getColor(m.ke);
+  return config;
+}
+
+vec3
+SceneBuilder::
+getColor(const vec3& _color) const {
+  if (!m_hasLinearColors) {
+    return _color;
+  }
+  return vec3(Texture::decodeSrgb(_color.x), Texture::decodeSrgb(_color.y),
+              Texture::decodeSrgb(_color.z));
 }
 
 Scene
@@ -99,6 +125,8 @@ buildSceneFromJsonFile(const string& _jsonFileName) {
 Scene
 SceneBuilder::
 buildSceneFromJson(const Json& _sceneJson) {
+  preloadAssets(_sceneJson);
+
   Scene scene;
   // lights
   Json lightsJson = _sceneJson.at("lights");
@@ -106,22 +134,22 @@ buildSceneFromJson(const Json& _sceneJson) {
     string type = j.at("type");
     glm::vec3 ia{0, 0, 0};
     if (j.find("i_a") != j.end()) {
-      ia = getVec3(j.at("i_a"));
+      ia = getColor(getVec3(j.at("i_a")));
     }
     if (type == "point") {
       scene.addLightSource(move(make_unique<PointLight>(
         getVec3(j.at("pos")),
         ia, 
-        getVec3(j.at("i_d")), 
-        getVec3(j.at("i_s")),
+        getColor(getVec3(j.at("i_d"))), 
+        getColor(getVec3(j.at("i_s"))),
         getVec3(j.at("a_l"))
       )));
     } else if (type == "directional") {
       scene.addLightSource(move(make_unique<DirectionalLight>(
         getVec3(j.at("dir")),
         ia, 
-        getVec3(j.at("i_d")), 
-        getVec3(j.at("i_s"))
+        getColor(getVec3(j.at("i_d"))), 
+        getColor(getVec3(j.at("i_s")))
       )));
     } else if (type == "spot") {
       scene.addLightSource(move(make_unique<SpotLight>(
@@ -129,8 +157,8 @@ buildSceneFromJson(const Json& _sceneJson) {
         getVec3(j.at("dir")),
         j.at("angle").get<float>(),
         ia, 
-        getVec3(j.at("i_d")), 
-        getVec3(j.at("i_s")),
+        getColor(getVec3(j.at("i_d"))), 
+        getColor(getVec3(j.at("i_s"))),
         getVec3(j.at("a_l")),
         j.at("a_a").get<float>()
       )));
@@ -141,40 +169,52 @@ buildSceneFromJson(const Json& _sceneJson) {
   Json objectsJson = _sceneJson.at("objects");
   for (auto& j : objectsJson) {
     string type = j.at("type");
-    if (type == "mesh") {
-      Mesh mesh = parseObjFile(j.at("obj").get<string>());
+    if (type == "mesh" && j.find("instances") != j.end()) {
+      // same mesh placed many times, each instance transform is relative to
+      // the transform of the whole object
+      mat4 transform = getTransform(j);
+      vector<mat4> instanceTransforms{};
+      for (auto& instanceJson : j.at("instances")) {
+        instanceTransforms.emplace_back(transform * getTransform(instanceJson));
+      }
+      scene.addObject(move(make_unique<InstancedObject>(
+        m_assets.getMesh(j.at("obj").get<string>()),
+        getMaterialConfig(j.at("material")),
+        instanceTransforms
+      )));
+    } else if (type == "mesh") {
       mat4 transform = getTransform(j);
       scene.addObject(move(make_unique<RasterizableObject>(
-        mesh,
-        j.at("material").get<MaterialConfig>(),
+        m_assets.getMesh(j.at("obj").get<string>()),
+        getMaterialConfig(j.at("material")),
         transform
       )));
     } else if (type == "sphere") {
       scene.addObject(move(make_unique<Sphere>(
         getVec3(j.at("center")), 
         j.at("radius").get<float>(), 
-        j.at("material").get<MaterialConfig>(),
+        getMaterialConfig(j.at("material")),
         m_isRayTrace
       )));
     } else if (type == "plane") {
       scene.addObject(move(make_unique<Plane>(
         getVec3(j.at("point")), 
         getVec3(j.at("normal")), 
-        j.at("material").get<MaterialConfig>()
+        getMaterialConfig(j.at("material"))
       )));
     } else if (type == "rectangle") {
       scene.addObject(move(make_unique<Rectangle>(
         getVec3(j.at("bot_left")),
         getVec3(j.at("right")),
         getVec3(j.at("up")),
-        j.at("material").get<MaterialConfig>()
+        getMaterialConfig(j.at("material"))
       )));
     } else if (type == "circle") {
       scene.addObject(move(make_unique<Circle>(
         getVec3(j.at("center")),
         j.at("radius").get<float>(), 
         getVec3(j.at("normal")), 
-        j.at("material").get<MaterialConfig>()
+        getMaterialConfig(j.at("material"))
       )));
     } else if (type == "portal") {
       scene.addObject(move(make_unique<Portal>(
@@ -198,7 +238,7 @@ buildSceneFromJson(const Json& _sceneJson) {
       }
       scene.addObject(move(make_unique<BezierSurface>(
         controls,
-        j.at("material").get<MaterialConfig>(),
+        getMaterialConfig(j.at("material")),
         getTransform(j)
       )));
     }
@@ -208,6 +248,22 @@ buildSceneFromJson(const Json& _sceneJson) {
   return scene;
 }
 
+void
+SceneBuilder::
+preloadAssets(const Json& _sceneJson) {
+  vector<string> objFiles{};
+  vector<string> mtlFiles{};
+  for (auto& j : _sceneJson.at("objects")) {
+    if (j.at("type") == "mesh") {
+      objFiles.push_back(j.at("obj").get<string>());
+    }
+    if (j.find("material") != j.end() && j.at("material").is_string()) {
+      mtlFiles.push_back(j.at("material").get<string>());
+    }
+  }
+  m_assets.preload(objFiles, mtlFiles);
+}
+
 void
 SceneBuilder::
 buildParticleSystem(Scene& scene, const Json& json) {
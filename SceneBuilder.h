@@ -6,13 +6,27 @@
 // Json parsing library
 #include "json.hpp"
 
+#include "AssetManager.h"
+#include "Material.h"
 #include "Scene.h"
 
 
 class SceneBuilder
 {
   public:
-    SceneBuilder(bool _isRayTrace) : m_isRayTrace(_isRayTrace) {};
+    ////////////////////////////////////////////////////////////////////////////
+    /// @param _textureSettings Storage of the scene textures, see
+    ///                         Renderer::getTextureSettings
+    /// @param _textureStreamer Streams textures of the scene if not null, and
+    ///                         must outlive the scene
+    SceneBuilder(bool _isRayTrace, const Texture::Settings& _textureSettings,
+                 TextureStreamer* _textureStreamer = nullptr)
+      : m_isRayTrace(_isRayTrace),
+        m_hasLinearColors(_textureSettings.hasLinearStorage)
+    {
+      m_assets.setTextureSettings(_textureSettings);
+      m_assets.setTextureStreamer(_textureStreamer);
+    };
 
     Scene buildSceneFromJsonFile(const std::string& _jsonFileName);
 
@@ -20,8 +34,28 @@ class SceneBuilder
 
   private:
     bool m_isRayTrace;
+    /// Shade in linear space, decoding the sRGB authored colors of materials
+    /// and lights as their textures are
+    bool m_hasLinearColors;
+    /// Share files referenced by several objects
+    AssetManager m_assets;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get the material config from either the name of a material file
+    /// or an inline material definition
+    MaterialConfig getMaterialConfig(const nlohmann::json& json);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Get a color of a material or light, decoded from sRGB if the
+    /// scene is shaded in linear space
+    glm::vec3 getColor(const glm::vec3& _color) const;
 
     void buildParticleSystem(Scene& scene, const nlohmann::json& json);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Load all mesh, material and texture files referenced by the
+    /// scene in parallel, before any object is built
+    void preloadAssets(const nlohmann::json& _sceneJson);
 };
 
 #endif // SCENE_BUILDER_H_
\ No newline at end of file
@@ -13,7 +13,21 @@ Sphere(glm::vec3 _center, float _radius, const MaterialConfig& _matConfig, bool
     ),
     m_center(_center), 
     m_radius(_radius)
-    {};
+{
+  if (_isRayTraced) {
+    return;
+  }
+  // A level is drawn until its segments, 2*pi*r/prec long, get too long on
+  // screen. Then the next finer level is needed.
+  std::vector<Mesh> meshes{};
+  std::vector<float> minScreenRadii{};
+  for (int i = 0, prec = _prec; i < N_LODS && (i == 0 || prec >= 4); 
+       i++, prec /= 2) {
+    meshes.push_back(i == 0 ? *m_mesh : generateMesh(prec));
+    minScreenRadii.push_back(prec / 2 * LOD_SEGMENT_PIXELS / glm::radians(360.f));
+  }
+  setLods(meshes, minScreenRadii);
+};
 
 RayHit 
 Sphere::
@@ -31,9 +45,15 @@ intersectRay(Ray _ray) const {
   }
   // return the smaller t
   float t = -bHalf - sqrt(discriminant);
-  glm::vec3 hitPos = p + d * t;
+  return {t, {0, 0}, 0, this};
+}
+
+SurfaceHit
+Sphere::
+surfaceAt(const Ray& _ray, const RayHit& _hit) const {
+  glm::vec3 hitPos = _ray.getOrigin() + _ray.getDirection() * _hit.t;
   glm::vec3 normal = glm::normalize(hitPos - m_center);
-  return {t, hitPos, normal, m_defaultMaterial};
+  return {hitPos, normal, m_defaultMaterial};
 }
 
 Mesh
@@ -6,16 +6,24 @@
 class Sphere : public RasterizableObject
 {
   public:
-    Sphere(glm::vec3 _center, float _radius, const MaterialConfig& _matConfig, bool _isRayTraced, int _prec = 10);
+    ////////////////////////////////////////////////////////////////////////////
+    /// @param _prec Number of segments around the finest level of detail, the
+    ///              coarser levels halve it
+    Sphere(glm::vec3 _center, float _radius, const MaterialConfig& _matConfig, bool _isRayTraced, int _prec = 48);
 
     RayHit intersectRay(Ray _ray) const override;
 
+    SurfaceHit surfaceAt(const Ray& _ray, const RayHit& _hit) const override;
+
   private:
     /// Center of the sphere
     glm::vec3 m_center;
     /// Radius of the sphere. Must be a positive number.
     float m_radius;
 
+    /// Number of levels of detail rasterized
+    static const int N_LODS = 4;
+
     static Mesh generateMesh(int _prec);
 };
 
@@ -27,16 +27,18 @@ getLightRay(glm::vec3 _destination) const {
   };
 }
 
-void 
+LightData
 SpotLight::
-sendLightData(LightUniformLocations locations) const {
-  glUniform1i (locations.type, 2); // type 2 is spot light
-  glUniform3fv(locations.pos, 1, glm::value_ptr(m_pos));
-  glUniform3fv(locations.dir, 1, glm::value_ptr(m_dir));
-  glUniform1f (locations.cutoffDot, m_cutoffDot);
-  glUniform3fv(locations.intensityAmbient,  1, glm::value_ptr(m_intensityAmbient));
-  glUniform3fv(locations.intensityDiffuse,  1, glm::value_ptr(m_intensityDiffuse));
-  glUniform3fv(locations.intensitySpecular, 1, glm::value_ptr(m_intensitySpecular));
-  glUniform3fv(locations.linearAttenuation, 1, glm::value_ptr(m_linearAttenuation));
-  glUniform1f (locations.angleAttenuation, m_angleAttenuation);
+getLightData() const {
+  LightData data{};
+  data.type = 2; // type 2 is spot light
+  data.pos = m_pos;
+  data.dir = m_dir;
+  data.cutoffDot = m_cutoffDot;
+  data.ia = m_intensityAmbient;
+  data.id = m_intensityDiffuse;
+  data.is = m_intensitySpecular;
+  data.al = m_linearAttenuation;
+  data.aa = m_angleAttenuation;
+  return data;
 }
\ No newline at end of file
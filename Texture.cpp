@@ -1,50 +1,290 @@
 #include "Texture.h"
+#include "TextureArray.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
 
+#include "BlockCompression.h"
 // image library
 #include "SOIL2.h"
 
 
+void
+Texture::ImageDeleter::
+operator()(unsigned char* _data) const {
+  SOIL_free_image_data(_data);
+}
+
+Texture::Image
+Texture::
+decode(const std::string& _imgFile) {
+  Image image;
+  image.data.reset(SOIL_load_image(_imgFile.c_str(), 
+      &image.width, &image.height, &image.channels, SOIL_LOAD_AUTO));
+  return image;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Header of the file caching the compressed blocks of an image, followed by
+/// the blocks
+struct CompressedCacheHeader {
+  int64_t sourceTime;  ///< Last write time of the image when compressed
+  uint64_t sourceSize; ///< Size of the image file when compressed
+  char magic[4];
+  uint32_t format;
+  int32_t width;
+  int32_t height;
+  int32_t channels;
+  int32_t content;
+};
+
+static const char COMPRESSED_CACHE_MAGIC[4] = {'B', 'C', 'T', '1'};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @return Header of a cache file matching the current image file, false if
+/// the image can't be found
+static bool
+getCompressedCacheHeader(const std::string& _imgFile, Texture::Content _content,
+                         CompressedCacheHeader& _header) {
+  std::error_code error;
+  auto time = std::filesystem::last_write_time(_imgFile, error);
+  if (error) {
+    return false;
+  }
+  uint64_t size = std::filesystem::file_size(_imgFile, error);
+  if (error) {
+    return false;
+  }
+  std::memset(&_header, 0, sizeof(_header));
+  _header.sourceTime = time.time_since_epoch().count();
+  _header.sourceSize = size;
+  std::memcpy(_header.magic, COMPRESSED_CACHE_MAGIC, sizeof(_header.magic));
+  _header.content = (int32_t)_content;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the compressed blocks of an image from its cache file
+/// @return Whether the cache is valid for the current image file
+static bool
+loadCompressedCache(const std::string& _imgFile, Texture::Content _content,
+                    Texture::Image& _image) {
+  CompressedCacheHeader expected, header;
+  if (!getCompressedCacheHeader(_imgFile, _content, expected)) {
+    return false;
+  }
+  std::ifstream ifs(_imgFile + ".bctex", std::ios::binary);
+  if (!ifs.read((char*)&header, sizeof(header)) 
+      || header.sourceTime != expected.sourceTime
+      || header.sourceSize != expected.sourceSize
+      || std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+      || header.content != expected.content) {
+    return false;
+  }
+  _image.width = header.width;
+  _image.height = header.height;
+  _image.channels = header.channels;
+  _image.compressedFormat = header.format;
+  _image.compressedData.assign(std::istreambuf_iterator<char>(ifs), 
+                               std::istreambuf_iterator<char>());
+  size_t blockSize = header.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+  size_t nBlocks = (size_t)((header.width + 3) / 4) * ((header.height + 3) / 4);
+  return _image.compressedData.size() == blockSize * nBlocks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the compressed blocks of an image next to it, ignoring failures
+static void
+saveCompressedCache(const std::string& _imgFile, Texture::Content _content,
+                    const Texture::Image& _image) {
+  CompressedCacheHeader header;
+  if (!getCompressedCacheHeader(_imgFile, _content, header)) {
+    return;
+  }
+  header.format = _image.compressedFormat;
+  header.width = _image.width;
+  header.height = _image.height;
+  header.channels = _image.channels;
+  std::string file = _imgFile + ".bctex";
+  std::ofstream ofs(file, std::ios::binary);
+  ofs.write((const char*)&header, sizeof(header));
+  ofs.write((const char*)_image.compressedData.data(), 
+            _image.compressedData.size());
+  if (!ofs) {
+    std::cerr << "Could not cache compressed texture '" << file << "'" << std::endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Compress a decoded image, if the driver supports a format for its content
+static void
+compress(Texture::Image& _image, Texture::Content _content, bool _hasS3tc) {
+  std::vector<unsigned char> rgba = Texture::expandToRgba(_image);
+  int width = _image.width;
+  int height = _image.height;
+  if (_content == Texture::Content::NORMAL_MAP) {
+    // RGTC is core since GL 3.0
+    _image.compressedFormat = GL_COMPRESSED_RG_RGTC2;
+    _image.compressedData = encodeBc5(rgba.data(), width, height);
+  } else if (!_hasS3tc) {
+    return;
+  } else if (_image.channels == 2 || _image.channels == 4) {
+    _image.compressedFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    _image.compressedData = encodeBc3(rgba.data(), width, height);
+  } else {
+    _image.compressedFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    _image.compressedData = encodeBc1(rgba.data(), width, height);
+  }
+}
+
+Texture::Image
+Texture::
+load(const std::string& _imgFile, const Settings& _settings, Content _content) {
+  // only the rasterizer samples compressed blocks, the ray tracer reads texels
+  bool isCompressed = _settings.hasCompression && !_settings.hasCpuCopy;
+  Image image;
+  if (isCompressed && loadCompressedCache(_imgFile, _content, image)) {
+    return image;
+  }
+  image = decode(_imgFile);
+  if (isCompressed && image.data) {
+    compress(image, _content, _settings.hasS3tc);
+    if (image.compressedFormat != 0) {
+      saveCompressedCache(_imgFile, _content, image);
+      image.data.reset();
+    }
+  }
+  return image;
+}
+
+std::vector<unsigned char>
+Texture::
+expandToRgba(const Image& _image) {
+  int width = _image.width;
+  int height = _image.height;
+  int channels = _image.channels;
+  std::vector<unsigned char> texels((size_t)width * height * 4);
+  for (int y = 0; y < height; y++) {
+    const unsigned char* src = &_image.data[(size_t)(height - 1 - y) * width * channels];
+    unsigned char* dst = &texels[(size_t)y * width * 4];
+    for (int x = 0; x < width; x++, src += channels, dst += 4) {
+      bool isGray = channels < 3;
+      dst[0] = src[0];
+      dst[1] = isGray ? src[0] : src[1];
+      dst[2] = isGray ? src[0] : src[2];
+      dst[3] = channels == 2 ? src[1] : channels == 4 ? src[3] : 255;
+    }
+  }
+  return texels;
+}
+
+Texture::
+Texture(Image&& _image, const Settings& _settings) 
+  : m_textureId(0),
+    m_image(std::move(_image))
+{
+  if (!m_image.data && m_image.compressedData.empty()) {
+    return;
+  }
+  // the image is decoded once, and only kept where a renderer reads it.
+  // Compressed images have no texels, they are only compressed without CPU copy.
+  if (_settings.hasCpuCopy && m_image.data) {
+    buildMips(_settings.hasLinearStorage);
+  }
+  if (_settings.hasGpuUpload) {
+    upload();
+  }
+  m_image.data.reset();
+  m_image.compressedData = std::vector<unsigned char>();
+}
+
+Texture::
+Texture(Image&& _image, std::shared_ptr<TextureArray> _array, int _layer,
+        const Settings& _settings)
+  : m_textureId(0),
+    m_image(std::move(_image)),
+    m_array(std::move(_array)),
+    m_layer(_layer)
+{
+  if (!m_image.data && m_image.compressedData.empty()) {
+    return;
+  }
+  if (_settings.hasCpuCopy && m_image.data) {
+    buildMips(_settings.hasLinearStorage);
+  }
+  if (_settings.hasGpuUpload) {
+    m_array->uploadLayer(m_layer, m_image);
+  }
+  m_image.data.reset();
+  m_image.compressedData = std::vector<unsigned char>();
+}
+
 Texture::
-Texture(const std::string& _imgFile) {
-  m_textureId = SOIL_load_OGL_texture(_imgFile.c_str(),
-      SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID, SOIL_FLAG_INVERT_Y);
-  m_texData = SOIL_load_image(
-      _imgFile.c_str(), &m_width, &m_height, 0, SOIL_LOAD_RGB);
+Texture(glm::u8vec4 _color)
+  : m_textureId(0)
+{
+  m_image.width = 1;
+  m_image.height = 1;
+  m_image.channels = 4;
+  glGenTextures(1, &m_textureId);
+  glBindTexture(GL_TEXTURE_2D, m_textureId);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, 
+               &_color);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 Texture::
 Texture(Texture&& t) 
   : m_textureId(t.m_textureId),
-    m_texData(t.m_texData),
-    m_width(t.m_width),
-    m_height(t.m_height)
+    m_image(std::move(t.m_image)),
+    m_array(std::move(t.m_array)),
+    m_layer(t.m_layer),
+    m_mips(std::move(t.m_mips)),
+    m_texels(std::move(t.m_texels)),
+    m_linearTexels(std::move(t.m_linearTexels))
 {
   t.m_textureId = 0;
-  t.m_texData = nullptr;
 }
 
 Texture&
 Texture::
 operator=(Texture&& t) {
+  if (m_textureId) {
+    glDeleteTextures(1, &m_textureId);
+  }
   m_textureId = t.m_textureId;
-  m_texData = t.m_texData;
-  m_width = t.m_width;
-  m_height = t.m_height;
+  m_image = std::move(t.m_image);
+  m_array = std::move(t.m_array);
+  m_layer = t.m_layer;
+  m_mips = std::move(t.m_mips);
+  m_texels = std::move(t.m_texels);
+  m_linearTexels = std::move(t.m_linearTexels);
   t.m_textureId = 0;
-  t.m_texData = nullptr;
+  return *this;
 }
 
 Texture::
 ~Texture() {
-  // free memory used by texture
+  // free memory used by texture, image data is freed by its deleter
   if(m_textureId) {
     glDeleteTextures(1, &m_textureId);
   }
-  if (m_texData != nullptr) {
-    SOIL_free_image_data(m_texData);
-  }
+}
+
+GLuint
+Texture::
+getId() const noexcept {
+  return m_array ? m_array->getId() : m_textureId;
 }
 
 void
@@ -52,24 +292,218 @@ Texture::
 activate(GLenum _textureUnit) const {
   if (isValid()) {
     glActiveTexture(_textureUnit);
-    glBindTexture(GL_TEXTURE_2D, m_textureId);
+    glBindTexture(getTarget(), getId());
+  }
+}
+
+bool
+Texture::
+isS3tcSupported() {
+  GLint nExtensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &nExtensions);
+  for (GLint i = 0; i < nExtensions; i++) {
+    const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+    if (extension && 
+        std::strcmp((const char*)extension, "GL_EXT_texture_compression_s3tc") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+Texture::
+upload() {
+  int width = m_image.width;
+  int height = m_image.height;
+  int channels = m_image.channels;
+  glGenTextures(1, &m_textureId);
+  glBindTexture(GL_TEXTURE_2D, m_textureId);
+  if (m_image.compressedFormat != 0) {
+    // blocks are already bottom to top, and expanded to RGB or RGBA
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, m_image.compressedFormat, 
+                           width, height, 0, m_image.compressedData.size(), 
+                           m_image.compressedData.data());
+    channels = 4;
+  } else {
+    // GL expects rows bottom to top
+    size_t rowSize = (size_t)width * channels;
+    unsigned char* data = m_image.data.get();
+    for (int y = 0; y < height / 2; y++) {
+      std::swap_ranges(data + y * rowSize, data + (y + 1) * rowSize, 
+                       data + (height - 1 - y) * rowSize);
+    }
+
+    static const GLint INTERNAL_FORMATS[] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+    static const GLenum FORMATS[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    // rows are tightly packed, whatever the number of channels
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, INTERNAL_FORMATS[channels - 1], width, height, 
+                 0, FORMATS[channels - 1], GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
   }
+  // grayscale images repeat their only color channel
+  if (channels < 3) {
+    GLint swizzle[] = {GL_RED, GL_RED, GL_RED, channels == 2 ? GL_GREEN : GL_ONE};
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-glm::vec3
+float
 Texture::
-sample(glm::vec2 _texCoord) const {
+decodeSrgb(float _c) {
+  return _c <= 0.04045f ? _c / 12.92f : std::pow((_c + 0.055f) / 1.055f, 2.4f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @return Linear value of each 8-bit sRGB encoded value
+static const std::array<float, 256>&
+getSrgbDecodeTable() {
+  static const std::array<float, 256> table = [] {
+    std::array<float, 256> decoded;
+    for (int i = 0; i < 256; i++) {
+      decoded[i] = Texture::decodeSrgb(i / 255.f);
+    }
+    return decoded;
+  }();
+  return table;
+}
+
+static glm::u8vec4
+average(glm::u8vec4 _a, glm::u8vec4 _b, glm::u8vec4 _c, glm::u8vec4 _d) {
+  glm::uvec4 sum = glm::uvec4(_a) + glm::uvec4(_b) + glm::uvec4(_c) + glm::uvec4(_d);
+  return glm::u8vec4((sum + 2u) / 4u);
+}
+
+static glm::vec4
+average(glm::vec4 _a, glm::vec4 _b, glm::vec4 _c, glm::vec4 _d) {
+  return (_a + _b + _c + _d) * 0.25f;
+}
+
+void
+Texture::
+buildMips(bool _isLinear) {
+  // Lay out all levels
+  m_mips.clear();
+  size_t size = 0;
+  int width = m_image.width;
+  int height = m_image.height;
+  while (true) {
+    m_mips.push_back({width, height, size});
+    size += (size_t)width * height;
+    if (width == 1 && height == 1) {
+      break;
+    }
+    width = std::max(width / 2, 1);
+    height = std::max(height / 2, 1);
+  }
+
+  // Copy the image into level 0, filling the channels it lacks
+  m_texels.assign(size, glm::u8vec4(0, 0, 0, 0));
+  int channels = m_image.channels;
+  const MipLevel& base = m_mips[0];
+  for (int y = 0; y < base.height; y++) {
+    for (int x = 0; x < base.width; x++) {
+      const unsigned char* t = &m_image.data[((size_t)y * base.width + x) * channels];
+      glm::u8vec4& texel = m_texels[texelIndex(base, x, y)];
+      if (channels < 3) {
+        // grayscale images repeat their only color channel
+        texel = glm::u8vec4(t[0], t[0], t[0], channels == 2 ? t[1] : 255);
+      } else {
+        texel = glm::u8vec4(t[0], t[1], t[2], channels == 4 ? t[3] : 255);
+      }
+    }
+  }
+
+  if (!_isLinear) {
+    downsampleMips(m_texels);
+    return;
+  }
+  // Decode level 0 and average the others in linear space, where averaging
+  // colors is correct. Alpha is linear already.
+  const std::array<float, 256>& decode = getSrgbDecodeTable();
+  size_t baseSize = m_mips.size() > 1 ? m_mips[1].offset : size;
+  m_linearTexels.assign(size, glm::vec4(0, 0, 0, 0));
+  for (size_t i = 0; i < baseSize; i++) {
+    const glm::u8vec4& t = m_texels[i];
+    m_linearTexels[i] = glm::vec4(decode[t.x], decode[t.y], decode[t.z], t.w / 255.f);
+  }
+  m_texels = std::vector<glm::u8vec4>();
+  downsampleMips(m_linearTexels);
+}
+
+template<typename T>
+void
+Texture::
+downsampleMips(std::vector<T>& _texels) {
+  for (size_t i = 1; i < m_mips.size(); i++) {
+    const MipLevel& src = m_mips[i - 1];
+    const MipLevel& dst = m_mips[i];
+    // odd sizes drop their last row or column, 1 texel sizes repeat it
+    for (int y = 0; y < dst.height; y++) {
+      int y0 = std::min(2 * y, src.height - 1);
+      int y1 = std::min(2 * y + 1, src.height - 1);
+      for (int x = 0; x < dst.width; x++) {
+        int x0 = std::min(2 * x, src.width - 1);
+        int x1 = std::min(2 * x + 1, src.width - 1);
+        _texels[texelIndex(dst, x, y)] = average(
+            _texels[texelIndex(src, x0, y0)], _texels[texelIndex(src, x1, y0)],
+            _texels[texelIndex(src, x0, y1)], _texels[texelIndex(src, x1, y1)]);
+      }
+    }
+  }
+}
+
+glm::vec4
+Texture::
+sampleBilinear(const MipLevel& _mip, float _x, float _y) const {
+  float fx = std::floor(_x - 0.5f);
+  float fy = std::floor(_y - 0.5f);
+  float wx = _x - 0.5f - fx;
+  float wy = _y - 0.5f - fy;
+  // repeat the texture, wrapping the 4 texels around its edges
+  int x0 = (int)fx % _mip.width;
+  int y0 = (int)fy % _mip.height;
+  x0 += x0 < 0 ? _mip.width : 0;
+  y0 += y0 < 0 ? _mip.height : 0;
+  int x1 = x0 + 1 == _mip.width ? 0 : x0 + 1;
+  int y1 = y0 + 1 == _mip.height ? 0 : y0 + 1;
+
+  glm::vec4 top = glm::mix(fetch(texelIndex(_mip, x0, y0)), 
+                           fetch(texelIndex(_mip, x1, y0)), wx);
+  glm::vec4 bottom = glm::mix(fetch(texelIndex(_mip, x0, y1)), 
+                              fetch(texelIndex(_mip, x1, y1)), wx);
+  return glm::mix(top, bottom, wy);
+}
+
+glm::vec4
+Texture::
+sample(glm::vec2 _texCoord, glm::vec2 _dUVdx, glm::vec2 _dUVdy) const {
   if(!isValid()) {
-    return {0, 0, 0};
-  }
-  // tile
-  float s = fmod(_texCoord.x, 1.0f);
-  float t = fmod(_texCoord.y, 1.0f);
-  int texX = round(s * m_width);
-  int texY = m_height - round(t * m_height); // invert Y coordinate
-  int pix = (texY * m_width + texX) * 3;
-  float r = m_texData[pix] / 255.0;
-  float g = m_texData[pix+1] / 255.0;
-  float b = m_texData[pix+2] / 255.0;
-  return {r, g, b};
+    return {0, 0, 0, 1};
+  }
+  // mip level where the pixel footprint covers about one texel
+  glm::vec2 size(m_image.width, m_image.height);
+  float footprint = std::max(glm::length(_dUVdx * size), 
+                             glm::length(_dUVdy * size));
+  float lod = footprint > 1 ? std::log2(footprint) : 0;
+  lod = std::min(lod, (float)(m_mips.size() - 1));
+  int level = (int)lod;
+  float weight = lod - level;
+
+  // rows are stored top to bottom, texture coordinates go bottom to top
+  glm::vec2 coord(_texCoord.x, 1 - _texCoord.y);
+  auto sampleLevel = [&](const MipLevel& _mip) {
+    return sampleBilinear(_mip, coord.x * _mip.width, coord.y * _mip.height);
+  };
+  glm::vec4 color = sampleLevel(m_mips[level]);
+  if (weight > 0) {
+    color = glm::mix(color, sampleLevel(m_mips[level + 1]), weight);
+  }
+  return color;
 }
@@ -1,17 +1,93 @@
 #ifndef TEXTURE_H_
 #define TEXTURE_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 // Open GL
 #include "GLInclude.h"
 
+class TextureArray;
+
 class Texture
 {
   public:
-    Texture() : m_textureId(0), m_texData(nullptr) {};
+    /// Frees pixel data allocated by the image library
+    struct ImageDeleter {
+      void operator()(unsigned char* _data) const;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Image decoded into CPU memory, not yet uploaded to the GPU.
+    /// Rows are stored top to bottom, as in the image file.
+    struct Image {
+      int width{0};
+      int height{0};
+      int channels{0};
+      std::unique_ptr<unsigned char[], ImageDeleter> data;
+      /// Format of compressedData, 0 if the image is not compressed
+      GLenum compressedFormat{0};
+      /// Compressed blocks of the image, rows of blocks bottom to top as GL
+      /// expects. Replaces data once compressed.
+      std::vector<unsigned char> compressedData;
+    };
+
+    /// What the texels of an image hold, which decides how it is compressed
+    enum class Content {
+      COLOR,      ///< Color, possibly with alpha
+      NORMAL_MAP, ///< Tangent space normal, only x and y are kept
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Where and how textures are stored, chosen by the renderer that
+    /// samples them (see Renderer::getTextureSettings)
+    struct Settings {
+      /// Upload to the GPU, for the rasterizer
+      bool hasGpuUpload{true};
+      /// Keep the texels in CPU memory, for the ray tracer
+      bool hasCpuCopy{true};
+      /// Store the ray traced texels as linear float RGBA, decoded from sRGB
+      /// once at load, instead of 8-bit sRGB RGBA converted at each sample.
+      /// Takes 4 times the memory.
+      bool hasLinearStorage{false};
+      /// Upload as compressed blocks, for the rasterizer only: BC5 for normal
+      /// maps, BC1 or BC3 for colors if S3TC is supported, uncompressed
+      /// otherwise
+      bool hasCompression{false};
+      /// Whether the driver supports S3TC, see isS3tcSupported
+      bool hasS3tc{false};
+      /// Pack same-size textures as layers of texture arrays, see AssetManager
+      bool hasTextureArrays{false};
+    };
+
+    Texture() : m_textureId(0) {};
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Load a texture from an image file. Must be called on the thread
+    /// owning the GL context.
+    Texture(const std::string& _imgFile, const Settings& _settings,
+            Content _content = Content::COLOR) 
+      : Texture(load(_imgFile, _settings, _content), _settings) {};
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Store an already decoded image where the settings ask for it.
+    /// Must be called on the thread owning the GL context when uploading.
+    Texture(Image&& _image, const Settings& _settings);
 
-    Texture(const std::string& _imgFile);
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief 1x1 rasterizer texture of a single color, standing in for an
+    /// image until TextureStreamer uploads it into the same texture name. Must
+    /// be called on the thread owning the GL context.
+    explicit Texture(glm::u8vec4 _color);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Store an already decoded image as a layer of a texture array for
+    /// the rasterizer, and for the ray tracer if the settings keep a CPU copy.
+    /// Must be called on the thread owning the GL context when uploading.
+    /// @param _array Array of the image's size, kept alive by the texture
+    Texture(Image&& _image, std::shared_ptr<TextureArray> _array, int _layer,
+            const Settings& _settings);
 
     ~Texture();
 
@@ -25,21 +101,121 @@ class Texture
 
     Texture& operator=(Texture&& t);
 
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Decode an image file into CPU memory. Does not touch GL, so it
+    /// can run on any thread.
+    static Image decode(const std::string& _imgFile);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Decode an image file as decode does, or get its compressed
+    /// blocks if the settings enable compression. Blocks are read from a cache
+    /// file next to the image, written at the first load. Does not touch GL.
+    static Image load(const std::string& _imgFile, const Settings& _settings,
+                      Content _content);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Whether the driver supports S3TC compressed formats. Must be
+    /// called on the thread owning the GL context.
+    static bool isS3tcSupported();
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Linear value of an sRGB encoded color channel. Values above 1
+    /// follow the same curve.
+    static float decodeSrgb(float _c);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return RGBA texels of a decoded image, rows bottom to top as GL
+    /// expects. Grayscale images repeat their only color channel.
+    static std::vector<unsigned char> expandToRgba(const Image& _image);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Whether the image was loaded, for the rasterizer or the ray
+    /// tracer depending on where it was stored
     bool isValid() const noexcept {
-      return m_textureId != 0 && m_texData != nullptr;
+      return getId() != 0 || !m_mips.empty();
     }
 
     void activate(GLenum _textureUnit) const;
 
-    glm::vec3 sample(glm::vec2 _texCoord) const;
+    /// Rasterizer texture name, 0 if not loaded. The name of the whole array
+    /// for a layer of a texture array.
+    GLuint getId() const noexcept;
+
+    /// Rasterizer texture target, GL_TEXTURE_2D_ARRAY for a layer of an array
+    GLenum getTarget() const noexcept {
+      return m_array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    }
+
+    /// Layer of the texture in its array, 0 if not in an array
+    int getLayer() const noexcept { return m_layer; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Sample the texture for the ray tracer, repeating it outside
+    /// [0, 1]. Filtered bilinearly within the mip level matching the
+    /// footprint, and linearly between levels.
+    /// @param _dUVdx Derivative of the texture coordinate with respect to the
+    ///               pixel x coordinate, zero to sample the full resolution
+    /// @param _dUVdy Same with respect to the pixel y coordinate
+    /// @return RGBA color, alpha is 1 for images without alpha channel
+    glm::vec4 sample(glm::vec2 _texCoord, 
+                     glm::vec2 _dUVdx = glm::vec2(0, 0),
+                     glm::vec2 _dUVdy = glm::vec2(0, 0)) const;
 
   private:
-    /// Rasterizer texture ID
+    /// Level of the mip pyramid of the ray traced texture
+    struct MipLevel {
+      int width;
+      int height;
+      size_t offset; ///< Index of the level's first texel
+    };
+
+    /// Rasterizer texture ID, 0 for a layer of an array
     GLuint m_textureId;
-    /// Texture data for ray tracer
-    unsigned char* m_texData;
-    int m_width;
-    int m_height;
+    /// Size and format of the image. Its data is freed once stored.
+    Image m_image;
+    /// Rasterizer array holding the texture as one of its layers, if any
+    std::shared_ptr<TextureArray> m_array;
+    int m_layer{0};
+    /// Mip pyramid, level 0 being the image itself
+    std::vector<MipLevel> m_mips;
+    /// Texels of all levels one after the other, expanded to RGBA. Rows go
+    /// top to bottom, as in the image. Only one of them is filled, depending
+    /// on the storage when the texture was created.
+    std::vector<glm::u8vec4> m_texels;      ///< sRGB encoded
+    std::vector<glm::vec4> m_linearTexels; ///< Linear
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Index of a texel in the texel storage
+    size_t texelIndex(const MipLevel& _mip, int _x, int _y) const {
+      return _mip.offset + (size_t)_y * _mip.width + _x;
+    }
+
+    glm::vec4 fetch(size_t _index) const {
+      return m_linearTexels.empty() 
+          ? glm::vec4(m_texels[_index]) / 255.f 
+          : m_linearTexels[_index];
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Expand the image to RGBA and build its mip pyramid, averaging
+    /// 2x2 texels of each level into the next
+    /// @param _isLinear Decode the texels from sRGB into linear floats
+    void buildMips(bool _isLinear);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Upload the image to a new GL texture. Flips the image data, if
+    /// not compressed.
+    void upload();
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Fill the levels after the first by averaging the previous one
+    template<typename T>
+    void downsampleMips(std::vector<T>& _texels);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Bilinear sample of a mip level
+    /// @param _x, _y Texel coordinate, with texel centers at half integers
+    glm::vec4 sampleBilinear(const MipLevel& _mip, float _x, float _y) const;
 };
 
-#endif // TEXTURE_H_
\ No newline at end of file
+#endif // TEXTURE_H_
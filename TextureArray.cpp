@@ -0,0 +1,65 @@
+#include "TextureArray.h"
+
+#include <vector>
+
+TextureArray::
+TextureArray(int _width, int _height, int _nLayers, GLenum _compressedFormat)
+  : m_textureId(0),
+    m_width(_width),
+    m_height(_height),
+    m_nLayers(_nLayers),
+    m_compressedFormat(_compressedFormat)
+{
+  glGenTextures(1, &m_textureId);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureId);
+  if (m_compressedFormat != 0) {
+    size_t blockSize = m_compressedFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+    size_t layerSize = blockSize * ((m_width + 3) / 4) * ((m_height + 3) / 4);
+    glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, 0, m_compressedFormat, 
+                           m_width, m_height, m_nLayers, 0, 
+                           layerSize * m_nLayers, nullptr);
+  } else {
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, m_width, m_height, m_nLayers,
+                 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+  // same sampling as single textures, see Texture::upload
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+TextureArray::
+~TextureArray() {
+  if (m_textureId) {
+    glDeleteTextures(1, &m_textureId);
+  }
+}
+
+void
+TextureArray::
+uploadLayer(int _layer, const Texture::Image& _image) {
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureId);
+  if (m_compressedFormat != 0) {
+    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, _layer, 
+                              m_width, m_height, 1, m_compressedFormat, 
+                              _image.compressedData.size(), 
+                              _image.compressedData.data());
+  } else {
+    std::vector<unsigned char> texels = Texture::expandToRgba(_image);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, _layer, m_width, m_height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+int
+TextureArray::
+getMaxLayers() {
+  static GLint maxLayers = 0;
+  if (maxLayers == 0) {
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  }
+  return maxLayers;
+}
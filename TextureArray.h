@@ -0,0 +1,53 @@
+#ifndef TEXTURE_ARRAY_H_
+#define TEXTURE_ARRAY_H_
+
+#include "GLInclude.h"
+#include "Texture.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief GL_TEXTURE_2D_ARRAY holding images of the same size as layers, so
+/// that objects with different texture maps can share one texture binding.
+///
+/// Layers are stored as RGBA8 whatever the channels of their image, since
+/// swizzles apply to the whole array, or all in the same compressed format.
+/// Each layer is owned by a Texture, which keeps the array alive.
+class TextureArray
+{
+  public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Allocate the layers, must be called on the thread owning the GL
+    /// context
+    /// @param _compressedFormat Compressed format of all layers, 0 for RGBA8
+    TextureArray(int _width, int _height, int _nLayers, 
+                 GLenum _compressedFormat = 0);
+
+    ~TextureArray();
+
+    TextureArray(const TextureArray&) = delete;
+
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    GLuint getId() const noexcept { return m_textureId; }
+
+    int getWidth() const noexcept { return m_width; }
+    int getHeight() const noexcept { return m_height; }
+    int getNumLayers() const noexcept { return m_nLayers; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Upload an image of the array's size and format into a layer,
+    /// expanding it to RGBA if not compressed. The image is left unchanged.
+    void uploadLayer(int _layer, const Texture::Image& _image);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Max number of layers of an array supported by the driver
+    static int getMaxLayers();
+
+  private:
+    GLuint m_textureId;
+    int m_width;
+    int m_height;
+    int m_nLayers;
+    GLenum m_compressedFormat;
+};
+
+#endif // TEXTURE_ARRAY_H_
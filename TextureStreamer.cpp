@@ -0,0 +1,222 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using std::shared_ptr, std::string, std::vector;
+
+TextureStreamer::
+TextureStreamer(size_t _memoryBudget, size_t _uploadBudget)
+  : m_memoryBudget(_memoryBudget),
+    m_uploadBudget(_uploadBudget)
+{}
+
+shared_ptr<const Texture>
+TextureStreamer::
+request(const string& _imgFile, glm::u8vec4 _placeholder) {
+  shared_ptr<const Texture> texture = std::make_shared<const Texture>(_placeholder);
+  // GL may reuse the name of a texture freed since the last update
+  auto old = m_entries.find(texture->getId());
+  if (old != m_entries.end()) {
+    retire(old->second);
+    m_entries.erase(old);
+  }
+  Entry& entry = m_entries[texture->getId()];
+  entry.texture = texture;
+  entry.file = _imgFile;
+  entry.lastUsed = m_frame;
+  entry.decoding = m_pool.submit([_imgFile]() { return decodeLevels(_imgFile); });
+  return texture;
+}
+
+void
+TextureStreamer::
+retire(const Entry& _entry) {
+  for (int level = _entry.baseLevel; level < _entry.nLevels; level++) {
+    m_residentBytes -= levelBytes(_entry, level);
+  }
+}
+
+void
+TextureStreamer::
+markUsed(GLuint _textureId) {
+  auto it = m_entries.find(_textureId);
+  if (it != m_entries.end()) {
+    it->second.lastUsed = m_frame;
+  }
+}
+
+void
+TextureStreamer::
+update() {
+  m_frame++;
+  // Forget textures no longer used by any object, GL freed their levels
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    Entry& entry = it->second;
+    if (entry.texture.expired()) {
+      retire(entry);
+      it = m_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Take finished decodings, and decode again evicted textures drawn again
+  vector<std::pair<GLuint, Entry*>> entries;
+  for (auto& [id, entry] : m_entries) {
+    if (entry.decoding.valid() && entry.decoding.wait_for(
+          std::chrono::seconds(0)) == std::future_status::ready) {
+      receiveLevels(entry);
+    }
+    if (isWanted(entry) && entry.baseLevel > 0 && entry.levels.empty() &&
+        !entry.decoding.valid() && !entry.file.empty()) {
+      string file = entry.file;
+      entry.decoding = m_pool.submit([file]() { return decodeLevels(file); });
+    }
+    entries.emplace_back(id, &entry);
+  }
+
+  // Upload coarse to fine, most recently drawn textures first
+  std::sort(entries.begin(), entries.end(), [](auto& _a, auto& _b) {
+    return _a.second->lastUsed > _b.second->lastUsed;
+  });
+  size_t uploaded = 0;
+  for (auto& [id, entry] : entries) {
+    while (entry->baseLevel > 0 && !entry->levels.empty()) {
+      int level = entry->baseLevel - 1;
+      size_t bytes = levelBytes(*entry, level);
+      if ((level < entry->residentLevel && !isWanted(*entry)) ||
+          (uploaded > 0 && uploaded + bytes > m_uploadBudget)) {
+        break;
+      }
+      uploadLevel(id, *entry);
+      uploaded += bytes;
+    }
+    // free decoded levels once uploaded, or long unused
+    bool isIdle = !isWanted(*entry) && entry->baseLevel <= entry->residentLevel &&
+                  entry->lastUsed + KEEP_DECODED_FRAMES < m_frame;
+    if (entry->baseLevel == 0 || isIdle) {
+      entry->levels = vector<Level>();
+    }
+  }
+
+  // Evict the finest levels of the least recently drawn textures
+  for (auto it = entries.rbegin();
+       it != entries.rend() && m_residentBytes > m_memoryBudget; ++it) {
+    auto& [id, entry] = *it;
+    if (isWanted(*entry)) {
+      // all others are drawn too
+      break;
+    }
+    while (entry->baseLevel < entry->residentLevel &&
+           m_residentBytes > m_memoryBudget) {
+      evictLevel(id, *entry);
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void
+TextureStreamer::
+receiveLevels(Entry& _entry) {
+  _entry.levels = _entry.decoding.get();
+  if (_entry.levels.empty()) {
+    std::cerr << "Error loading texture '" << _entry.file << "'" << std::endl;
+    _entry.file.clear();
+    return;
+  }
+  if (_entry.nLevels > 0) {
+    // decoded again after eviction, the coarse levels are still uploaded
+    return;
+  }
+  _entry.width = _entry.levels[0].width;
+  _entry.height = _entry.levels[0].height;
+  _entry.nLevels = (int)_entry.levels.size();
+  _entry.baseLevel = _entry.nLevels;
+  _entry.residentLevel = _entry.nLevels - 1;
+  while (_entry.residentLevel > 0 &&
+         std::max(_entry.levels[_entry.residentLevel - 1].width,
+                  _entry.levels[_entry.residentLevel - 1].height) <= RESIDENT_SIZE) {
+    _entry.residentLevel--;
+  }
+}
+
+void
+TextureStreamer::
+uploadLevel(GLuint _textureId, Entry& _entry) {
+  int level = _entry.baseLevel - 1;
+  const Level& mip = _entry.levels[level];
+  glBindTexture(GL_TEXTURE_2D, _textureId);
+  glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, mip.width, mip.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, mip.texels.data());
+  if (_entry.baseLevel == _entry.nLevels) {
+    // replace the placeholder, which stays in level 0 out of the used range
+    // until the full resolution replaces it
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _entry.nLevels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+  _entry.baseLevel = level;
+  m_residentBytes += levelBytes(_entry, level);
+}
+
+void
+TextureStreamer::
+evictLevel(GLuint _textureId, Entry& _entry) {
+  int level = _entry.baseLevel;
+  glBindTexture(GL_TEXTURE_2D, _textureId);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+  // an empty image frees the level's storage
+  glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  _entry.baseLevel = level + 1;
+  m_residentBytes -= levelBytes(_entry, level);
+}
+
+size_t
+TextureStreamer::
+levelBytes(const Entry& _entry, int _level) {
+  size_t width = std::max(_entry.width >> _level, 1);
+  size_t height = std::max(_entry.height >> _level, 1);
+  return width * height * 4;
+}
+
+vector<TextureStreamer::Level>
+TextureStreamer::
+decodeLevels(const string& _imgFile) {
+  vector<Level> levels;
+  Texture::Image image = Texture::decode(_imgFile);
+  if (!image.data) {
+    return levels;
+  }
+
+  Level base{image.width, image.height, Texture::expandToRgba(image)};
+  image.data.reset();
+  levels.push_back(std::move(base));
+
+  // Average 2x2 texels of each level into the next, as Texture::buildMips.
+  // Odd sizes drop their last row or column, 1 texel sizes repeat it.
+  while (levels.back().width > 1 || levels.back().height > 1) {
+    const Level& src = levels.back();
+    Level dst{std::max(src.width / 2, 1), std::max(src.height / 2, 1), {}};
+    dst.texels.resize((size_t)dst.width * dst.height * 4);
+    for (int y = 0; y < dst.height; y++) {
+      int y0 = std::min(2 * y, src.height - 1);
+      int y1 = std::min(2 * y + 1, src.height - 1);
+      for (int x = 0; x < dst.width; x++) {
+        int x0 = std::min(2 * x, src.width - 1);
+        int x1 = std::min(2 * x + 1, src.width - 1);
+        for (int c = 0; c < 4; c++) {
+          auto texel = [&](int _x, int _y) {
+            return (unsigned)src.texels[((size_t)_y * src.width + _x) * 4 + c];
+          };
+          dst.texels[((size_t)y * dst.width + x) * 4 + c] = (unsigned char)(
+              (texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1) + 2) / 4);
+        }
+      }
+    }
+    levels.push_back(std::move(dst));
+  }
+  return levels;
+}
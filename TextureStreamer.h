@@ -0,0 +1,129 @@
+#ifndef TEXTURE_STREAMER_H_
+#define TEXTURE_STREAMER_H_
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GLInclude.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Load rasterizer textures in the background, so that a scene can be
+/// drawn before its images are decoded.
+///
+/// A requested texture starts as a 1x1 placeholder color, while its image is
+/// decoded and its mip chain built on worker threads. Each frame, update
+/// uploads the decoded levels from the coarsest to the finest within a byte
+/// budget, into the same GL texture name so that objects keep their bindings.
+/// Levels up to RESIDENT_SIZE texels wide are always uploaded, finer ones only
+/// for textures drawn in the previous frame. Once the uploaded levels exceed
+/// the memory budget, the finest levels of the least recently drawn textures
+/// are evicted, and decoded again when the textures are drawn again.
+class TextureStreamer
+{
+  public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @param _memoryBudget Bytes of uploaded levels above which the least
+    ///                      recently drawn are evicted
+    /// @param _uploadBudget Bytes uploaded per frame, at least one level is
+    TextureStreamer(size_t _memoryBudget = 256 << 20,
+                    size_t _uploadBudget = 8 << 20);
+
+    TextureStreamer(const TextureStreamer&) = delete;
+
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Create a placeholder texture and queue the decoding of its image.
+    /// Must be called on the thread owning the GL context.
+    /// @param _placeholder Color of the texture until its image is uploaded
+    std::shared_ptr<const Texture> request(const std::string& _imgFile,
+                                           glm::u8vec4 _placeholder);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Record that a texture is drawn this frame, so that its finest
+    /// levels are loaded and kept. Ignores names the streamer doesn't own.
+    void markUsed(GLuint _textureId);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Upload decoded levels and evict levels over the memory budget,
+    /// once per frame before drawing. Binds textures on the active unit.
+    void update();
+
+    /// Bytes of the levels uploaded by the streamer
+    size_t getResidentBytes() const { return m_residentBytes; }
+
+  private:
+    /// Widest level always uploaded, whether the texture is drawn or not
+    static const int RESIDENT_SIZE = 64;
+    /// Frames after which a texture that is not drawn frees its decoded levels
+    static const uint64_t KEEP_DECODED_FRAMES = 120;
+
+    /// Decoded mip level, RGBA rows from bottom to top as GL expects
+    struct Level {
+      int width;
+      int height;
+      std::vector<unsigned char> texels;
+    };
+
+    struct Entry {
+      std::weak_ptr<const Texture> texture; ///< Freed with its last object
+      std::string file; ///< Image file, empty if it could not be decoded
+      int width{0};     ///< Size of level 0, 0 until decoded once
+      int height{0};
+      int nLevels{0};   ///< Levels of the full chain, 0 until decoded once
+      int baseLevel{0}; ///< Finest uploaded level, nLevels if none is
+      int residentLevel{0}; ///< Finest level never evicted
+      std::vector<Level> levels; ///< Decoded levels, empty once not needed
+      std::future<std::vector<Level>> decoding; ///< Valid while decoding
+      uint64_t lastUsed{0}; ///< Last frame the texture was drawn
+    };
+
+    size_t m_memoryBudget;
+    size_t m_uploadBudget;
+    size_t m_residentBytes{0};
+    uint64_t m_frame{0};
+    std::unordered_map<GLuint, Entry> m_entries; ///< By texture name
+    /// Declared last, so that it finishes its tasks before the rest is freed
+    ThreadPool m_pool;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Decode an image and build its mip chain, on a worker thread
+    /// @return Levels from the full resolution to 1x1, empty on failure
+    static std::vector<Level> decodeLevels(const std::string& _imgFile);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Account for the uploaded levels of a texture freed by GL, before
+    /// its entry is erased
+    void retire(const Entry& _entry);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Take the levels of a finished decoding
+    void receiveLevels(Entry& _entry);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Upload the level finer than the base level and make it the base
+    void uploadLevel(GLuint _textureId, Entry& _entry);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Free the base level and make the next coarser one the base
+    void evictLevel(GLuint _textureId, Entry& _entry);
+
+    static size_t levelBytes(const Entry& _entry, int _level);
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @return Whether the texture was drawn in the previous frame, or was
+    /// requested since
+    bool isWanted(const Entry& _entry) const {
+      return _entry.lastUsed + 1 >= m_frame;
+    }
+};
+
+#endif // TEXTURE_STREAMER_H_
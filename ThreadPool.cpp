@@ -0,0 +1,45 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::
+ThreadPool(unsigned int _nThreads)
+  : m_isStopping(false)
+{
+  // hardware_concurrency may return 0 if unknown
+  _nThreads = std::max(1u, _nThreads);
+  for (unsigned int i = 0; i < _nThreads; i++) {
+    m_workers.emplace_back(&ThreadPool::runWorker, this);
+  }
+}
+
+ThreadPool::
+~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isStopping = true;
+  }
+  m_hasTask.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void
+ThreadPool::
+runWorker() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_hasTask.wait(lock, [this]() { return m_isStopping || !m_tasks.empty(); });
+      if (m_tasks.empty()) {
+        // stopping and nothing left to do
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop();
+    }
+    task();
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Fixed set of worker threads running submitted tasks in FIFO order
+class ThreadPool
+{
+  public:
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Start the worker threads
+    /// @param _nThreads Number of workers, defaults to the number of cores
+    explicit ThreadPool(unsigned int _nThreads = std::thread::hardware_concurrency());
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Finish all queued tasks, then join the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////
+    /// @brief Queue a task to run on a worker thread
+    /// @return Future holding the task's result, or the exception it threw
+    template<typename F>
+    auto submit(F&& _task) -> std::future<decltype(_task())>;
+
+  private:
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex; ///< Guards m_tasks and m_isStopping
+    std::condition_variable m_hasTask;
+    bool m_isStopping;
+
+    void runWorker();
+};
+
+template<typename F>
+auto
+ThreadPool::
+submit(F&& _task) -> std::future<decltype(_task())> {
+  // std::function must be copyable, so share the move-only packaged_task
+  auto task = std::make_shared<std::packaged_task<decltype(_task())()>>(
+      std::forward<F>(_task));
+  std::future<decltype(_task())> result = task->get_future();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.emplace([task]() { (*task)(); });
+  }
+  m_hasTask.notify_one();
+  return result;
+}
+
+#endif // THREAD_POOL_H_
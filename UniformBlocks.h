@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief CPU side layout of the std140 uniform blocks declared in
+///        shaders/uniform_blocks.glsl. Both must be kept in sync.
+////////////////////////////////////////////////////////////////////////////////
+#ifndef UNIFORM_BLOCKS_H_
+#define UNIFORM_BLOCKS_H_
+
+#include "GLInclude.h"
+
+/// Binding points of the uniform blocks
+const GLuint FRAME_DATA_BINDING  = 0;
+const GLuint OBJECT_DATA_BINDING = 1;
+
+/// Max number of lights in the light buffer
+const int MAX_LIGHTS = 1024;
+
+/// Number of ObjectData in the ObjectData block, i.e. max number of objects
+/// drawn by one batched call
+const int MAX_BATCH_OBJECTS = 64;
+
+/// Bits of ObjectData::flags
+enum ObjectFlag : GLint {
+  FLAG_TRANSPARENCY    = 1 << 0,
+  FLAG_KD_MAP          = 1 << 1,
+  FLAG_KS_MAP          = 1 << 2,
+  FLAG_KE_MAP          = 1 << 3,
+  FLAG_NORMAL_MAP      = 1 << 4,
+  FLAG_PARALLAX_MAP    = 1 << 5,
+  FLAG_PACKED_VERTICES = 1 << 6,
+  FLAG_INSTANCES       = 1 << 7,
+  FLAG_TEXTURE_ARRAYS  = 1 << 8,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Light data in the rasterizer, read from a texture buffer as 6 RGBA32F
+/// texels. Each vec3 is followed by a scalar to fill the texel, type is read
+/// back from its float bits.
+struct LightData {
+  glm::vec3 pos;       ///< Position of light, in world coordinate
+  GLint     type;      ///< Light type: 1 point, 2 spot, 3 directional
+  glm::vec3 dir;       ///< Direction of light, in world coordinate
+  float     cutoffDot; ///< Min dot product, aka cos(maxAngle)
+  glm::vec3 ia;        ///< Ambient intensity
+  float     aa;        ///< Angular attenuation
+  glm::vec3 id;        ///< Diffuse intensity
+  float     pad0;
+  glm::vec3 is;        ///< Specular intensity
+  float     pad1;
+  glm::vec3 al;        ///< Linear attenuation (1,x,x**2 coefficients)
+  float     pad2;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Data shared by all objects, updated once per frame
+struct FrameData {
+  glm::mat4  viewProjectionMatrix; ///< Transform from world to homogeneous coordinate
+  glm::mat4  viewMatrix;           ///< Transform from world to camera space
+  glm::vec3  cameraPos;            ///< Position of camera in the world
+  GLint      numGlobalLights;      ///< Number of lights reaching every cluster,
+                                   ///< first in the light buffer
+  glm::vec3  ambientIntensity;     ///< Sum of ambient intensity of all lights
+  float      clusterDepthScale;    ///< Depth slice of view depth z is f(z)*scale-bias
+  glm::vec2  clusterTileSize;      ///< Size of the screen tile of a cluster, in pixels
+  float      clusterDepthBias;
+  GLint      isClusterDepthLog;    ///< f is log if set, identity otherwise
+  glm::ivec3 clusterCounts;        ///< Number of clusters along x, y, depth
+  GLint      pad0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Default material of an object, if not texture mapped
+struct MaterialData {
+  glm::vec3 ka;
+  float     shininess;
+  glm::vec3 kd;
+  float     transparency;
+  glm::vec3 ks;
+  float     pad0;
+  glm::vec3 ke;
+  float     pad1;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Data of a single object. The ObjectData block is an array of
+/// MAX_BATCH_OBJECTS of them, so that a batched draw can reach the data of all
+/// its objects.
+struct ObjectData {
+  glm::mat4    vertexModelMatrix; ///< Transform vertex from model to world
+  glm::mat4    normalModelMatrix; ///< Transform normal from model to world
+  glm::vec3    positionOffset;    ///< Decode packed position: offset + scale*p
+  GLint        flags;             ///< Combination of ObjectFlag
+  glm::vec3    positionScale;
+  GLint        parallaxLayer;     ///< Layer of the parallax map in its array
+  glm::ivec4   mapLayers;         ///< Layers of the kd, ks, ke and normal maps
+                                  ///< in their arrays, if FLAG_TEXTURE_ARRAYS
+  MaterialData material;
+};
+
+static_assert(sizeof(LightData)  == 96,  "LightData must match std140 layout");
+static_assert(sizeof(FrameData)  == 192, "FrameData must match std140 layout");
+static_assert(sizeof(ObjectData) == 240, "ObjectData must match std140 layout");
+
+/// Size of a buffer range bound to the ObjectData block
+const GLsizeiptr OBJECT_DATA_BLOCK_SIZE = sizeof(ObjectData) * MAX_BATCH_OBJECTS;
+
+#endif // UNIFORM_BLOCKS_H_
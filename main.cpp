@@ -26,6 +26,7 @@
 #include "RayTracer.h"
 #include "Rasterizer.h"
 #include "Renderer.h"
+#include "TextureStreamer.h"
 
 using glm::vec2, glm::vec3, glm::vec4, glm::mat4;
 using std::cout, std::endl;
@@ -57,6 +58,8 @@ Scene g_scene;
 // Rendererr
 std::unique_ptr<Renderer> g_renderer{nullptr};
 bool g_isRayTrace;
+// Background texture loading of the rasterizer, null if disabled
+std::unique_ptr<TextureStreamer> g_textureStreamer{nullptr};
 
 ////////////////////////////////////////////////////////////////////////////////
 // Functions
@@ -66,7 +69,8 @@ bool g_isRayTrace;
 void
 initialize(const std::string& sceneFile) {
   // initialize scene
-  SceneBuilder sceneBuilder{g_isRayTrace};
+  SceneBuilder sceneBuilder{g_isRayTrace, g_renderer->getTextureSettings(),
+                            g_textureStreamer.get()};
   g_scene = sceneBuilder.buildSceneFromJsonFile(sceneFile);
   g_renderer->initScene(g_scene);
 }
@@ -150,6 +154,11 @@ keyPressed(GLubyte _key, GLint _x, GLint _y) {
       g_renderer->setAntiAlias(g_hasAntiAliasing);
       std::cout << "Anti-alias: " << g_hasAntiAliasing << std::endl;
       break;
+    // S key: switch printing renderer statistics
+    case 's':
+      g_renderer->setStatsOutput(!g_renderer->hasStatsOutput());
+      std::cout << "Statistics: " << g_renderer->hasStatsOutput() << std::endl;
+      break;
     // V key: switch projection mode
     case 'v':
       g_isPerspectiveView = !g_renderer->isPerspectiveView();
@@ -306,9 +315,22 @@ main(int _argc, char** _argv) {
   //////////////////////////////////////////////////////////////////////////////
   // Initialize scene
   if (g_isRayTrace) {
-    g_renderer = std::make_unique<RayTracer>(g_width, g_height);
+    auto rayTracer = std::make_unique<RayTracer>(g_width, g_height);
+    rayTracer->setLinearTextures(config.linearTextures);
+    g_renderer = std::move(rayTracer);
   } else {
-    g_renderer = std::make_unique<Rasterizer>(g_width, g_height);
+    auto rasterizer = std::make_unique<Rasterizer>(g_width, g_height);
+    rasterizer->setTextureArrays(config.textureArrays);
+    rasterizer->setCompressedTextures(config.compressedTextures);
+    rasterizer->setCompactVertices(config.compactVertices);
+    rasterizer->setDepthPrepass(config.depthPrepass);
+    rasterizer->setOrderIndependentTransparency(
+        config.orderIndependentTransparency);
+    if (config.textureStreaming) {
+      g_textureStreamer = std::make_unique<TextureStreamer>();
+      rasterizer->setTextureStreamer(g_textureStreamer.get());
+    }
+    g_renderer = std::move(rasterizer);
   }
   initialize(config.sceneFile);
 
@@ -0,0 +1,13 @@
+////////////////////////////////////////////////////////////////////////////////
+// Fullscreen vertex shader - makes a triangle covering the screen from the
+// vertex ids 0 to 2, without any vertex attribute
+////////////////////////////////////////////////////////////////////////////////
+
+#version 330
+
+out vec2 texCoord; // Texture coordinate of the screen, [0, 1] on screen
+
+void main() {
+  texCoord = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  gl_Position = vec4(2 * texCoord - 1, 0, 1);
+}
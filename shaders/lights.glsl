@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////
+// Lights of the scene and their clusters, stored in texture buffers. Layout
+// must match LightData in UniformBlocks.h and LightClusters.h.
+//
+// Lights reaching everything come first in the light buffer. The others are
+// only listed in the clusters of the view frustum they reach.
+////////////////////////////////////////////////////////////////////////////////
+
+#define TYPE_POINT_LIGHT 1
+#define TYPE_SPOT_LIGHT  2
+#define TYPE_DIR_LIGHT   3
+struct Light {
+  vec3  pos;  // position of light, in world coordinate
+  int   type; // light type
+  vec3  dir;  // direction of light, in world coordinate
+  float cutoffDot; // min dot product, aka cos(maxAngle)
+  float aa;   // angular attenuation
+  vec3  id;   // diffuse intensity
+  vec3  is;   // specular intensity
+  vec3  al;   // linear attenuation (1,x,x**2 coefficients)
+};
+
+uniform samplerBuffer  lightDataSampler;  // 6 texels per light
+uniform usamplerBuffer clusterSampler;    // (first index, number of lights)
+uniform usamplerBuffer lightIndexSampler; // indices of lights of each cluster
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read a light from the light buffer
+Light fetchLight(in int index) {
+  int base = 6 * index;
+  vec4 t0 = texelFetch(lightDataSampler, base);
+  vec4 t1 = texelFetch(lightDataSampler, base + 1);
+  vec4 t2 = texelFetch(lightDataSampler, base + 2);
+  Light light;
+  light.pos = t0.xyz;
+  light.type = floatBitsToInt(t0.w);
+  light.dir = t1.xyz;
+  light.cutoffDot = t1.w;
+  light.aa = t2.w; // t2.xyz is ambient, summed in FrameData
+  light.id = texelFetch(lightDataSampler, base + 3).xyz;
+  light.is = texelFetch(lightDataSampler, base + 4).xyz;
+  light.al = texelFetch(lightDataSampler, base + 5).xyz;
+  return light;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Find the lights of the cluster holding a fragment
+/// @param worldPos Position of fragment in world space
+/// @return Index of the first light in the light index buffer, and number of
+///         lights
+uvec2 fetchCluster(in vec3 worldPos) {
+  ivec2 tile = ivec2(gl_FragCoord.xy / clusterTileSize);
+  float depth = -(viewMatrix * vec4(worldPos, 1)).z;
+  float f = isClusterDepthLog != 0 ? log(max(depth, 1e-6)) : depth;
+  int slice = int(floor(f * clusterDepthScale - clusterDepthBias));
+  ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), clusterCounts - 1);
+  int index = (cluster.z * clusterCounts.y + cluster.y) * clusterCounts.x 
+              + cluster.x;
+  return texelFetch(clusterSampler, index).xy;
+}
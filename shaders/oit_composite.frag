@@ -0,0 +1,23 @@
+////////////////////////////////////////////////////////////////////////////////
+// Weighted blended transparency composite - blends the average color of the
+// transparent fragments over the opaque color, by how much of the opaque
+// color they let through
+////////////////////////////////////////////////////////////////////////////////
+
+#version 330
+
+uniform sampler2D opaqueSampler; // color of opaque objects
+uniform sampler2D accumSampler;  // sum of weighted colors, revealage in alpha
+uniform sampler2D weightSampler; // sum of weights
+
+out vec4 color;
+
+void main() {
+  ivec2 pixel = ivec2(gl_FragCoord.xy);
+  vec3 opaque = texelFetch(opaqueSampler, pixel, 0).rgb;
+  vec4 accum = texelFetch(accumSampler, pixel, 0);
+  float weight = texelFetch(weightSampler, pixel, 0).r;
+  float revealage = accum.a;
+  vec3 transparent = accum.rgb / max(weight, 1e-5);
+  color = vec4(mix(transparent, opaque, revealage), 1);
+}
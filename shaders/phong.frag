@@ -8,53 +8,31 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Uniforms
 
-// Properties of the scene
-#define MAX_LIGHTS 8
-#define TYPE_POINT_LIGHT 1
-#define TYPE_SPOT_LIGHT  2
-#define TYPE_DIR_LIGHT   3
-struct Light {
-  int   type; // light type
-  vec3  pos;  // position of light, in world coordinate
-  vec3  dir;  // direction of light, in world coordinate
-  float cutoffDot; // min dot product, aka cos(maxAngle)
-  vec3  ia;   // ambient intensity
-  vec3  id;   // diffuse intensity
-  vec3  is;   // specular intensity
-  vec3  al;   // linear attenuation (1,x,x**2 coefficients)
-  float aa;   // angular attenuation
-};
-
-uniform int   numLights;          // number of lights in the scene
-uniform Light lights[MAX_LIGHTS]; // lights in the scene
-uniform vec3  cameraPos;          // Position of camera in the world
-
-// Properties of the object
-uniform bool hasTransparency = false; // Any part of the object is transparent?
-uniform bool hasKdMap = false;  // Is object Kd from texture, or material?
-uniform bool hasKsMap = false;  // Is object Ks from texture, or material?
-uniform bool hasKeMap = false;  // Is object Ke from texture, or material?
-uniform bool hasNormalMap = false;    // Is object normal mapped?
-uniform bool hasParallaxMap = false;  // Is object parallax mapped?
+#include "uniform_blocks.glsl"
+#include "lights.glsl"
+
+// Texture maps of the object. The sampler type is fixed at compile time, so
+// the HAS_TEXTURE_ARRAYS define is required here.
+#if HAS_TEXTURE_ARRAYS
+// Layers of arrays shared with other objects, layer given by the object data
+uniform sampler2DArray kdTextureSampler;     // diffuse mapping
+uniform sampler2DArray ksTextureSampler;     // specular mapping
+uniform sampler2DArray keTextureSampler;     // emission mapping
+uniform sampler2DArray normalTextureSampler; // normal mapping
+uniform sampler2DArray parallaxTextureSampler;  // parallax mapping
+#define sampleMap(sampler, layer, texCoord) texture(sampler, vec3(texCoord, layer))
+#else
 uniform sampler2D kdTextureSampler;     // diffuse mapping
 uniform sampler2D ksTextureSampler;     // specular mapping
 uniform sampler2D keTextureSampler;     // emission mapping
 uniform sampler2D normalTextureSampler; // normal mapping
 uniform sampler2D parallaxTextureSampler;  // parallax mapping
+#define sampleMap(sampler, layer, texCoord) texture(sampler, texCoord)
+#endif
 
 uniform float parallaxScale = 0.1;
 uniform int parallaxSteps = 50;
 
-struct Material {
-  vec3 ka;
-  vec3 kd;
-  vec3 ks;
-  vec3 ke;
-  float shininess;
-  float transparency;
-};
-uniform Material material;        // Default material of the object, if not texture mapped
-
 
 ////////////////////////////////////////////////////////////////////////////////
 // Vertex input/output
@@ -63,10 +41,57 @@ in VS_OUT {
   vec3 worldNormal;  // Vertex normal in world space
   vec2 texCoord;     // Vertex's texture coordinate
   vec3 worldTangent; // Vertex tangent in world space
+  flat int objectIndex; // Index of the object in the ObjectData array
 } fsIn;
 
+#ifdef WEIGHTED_OIT
+// Weighted blended transparency targets, summed over all fragments of a pixel
+layout(location = 0) out vec4 accum;   // weighted color, revealage in alpha
+layout(location = 1) out float weight; // weight of the color
+#else
 out vec4 color;       // Assigned vertex color to send to rasterizer
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Diffuse and specular illumination from one light
+/// @param pos    Position of vertex in world space
+/// @param normal Normal of vertex in world space
+vec3 shadeLight(in Light light, in vec3 pos, in vec3 normal, in vec3 viewDir,
+                in vec3 kd, in vec3 ks) {
+  // calculate direction and attenuation to light of specific light types
+  float attenuation = 0;
+  vec3 lightDir;  // direction toward light
+  if (light.type == TYPE_POINT_LIGHT) {
+    lightDir = light.pos - pos;
+    float d = length(lightDir);
+    lightDir /= d;
+    vec3 al = light.al;
+    attenuation = 1/(al[0] + al[1]*d + al[2]*d*d);
+  } else if (light.type == TYPE_DIR_LIGHT) {
+    attenuation = 1;
+    lightDir = -light.dir;
+  } else if (light.type == TYPE_SPOT_LIGHT) {
+    lightDir = light.pos - pos;
+    float d = length(lightDir);
+    lightDir /= d;
+    float dotProd = -dot(lightDir, light.dir);
+    if (dotProd > light.cutoffDot) {
+      vec3 al = light.al;
+      attenuation = pow(dotProd, light.aa) / (al[0] + al[1]*d + al[2]*d*d);
+    }
+  }
 
+  // diffuse
+  vec3 color = attenuation * kd * light.id * max(0.0, dot(normal, lightDir));
+  // specular
+  vec3 halfVec = normalize(viewDir + lightDir);
+  color += attenuation 
+           * ks 
+           * light.is 
+           * pow(max(0.0, dot(normal, halfVec)), object.material.shininess);
+  return color;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Determine the vertex's color using Blinn-Phong illumination model
@@ -75,59 +100,34 @@ out vec4 color;       // Assigned vertex color to send to rasterizer
 vec4 shadeBlinnPhong(in vec3 pos, in vec3 normal, in vec3 viewDir, in vec2 texCoord) {
   // accumulated color
   vec3 color = hasKeMap 
-      ? texture(keTextureSampler, texCoord).xyz 
-      : material.ke;
+      ? sampleMap(keTextureSampler, object.mapLayers.z, texCoord).xyz 
+      : object.material.ke;
 
   // material of the current fragment, comes from either texture of default material
-  vec3 kd = material.kd;
-  float transparency = hasTransparency? material.transparency : 1;
+  vec3 kd = object.material.kd;
+  float transparency = hasTransparency? object.material.transparency : 1;
   if (hasKdMap) {
-    vec4 texel = texture(kdTextureSampler, texCoord);
+    vec4 texel = sampleMap(kdTextureSampler, object.mapLayers.x, texCoord);
     kd = texel.rgb;
     transparency = hasTransparency? texel.a : 1; 
   }
-  vec3 ka = material.ka;
-  vec3 ks = hasKsMap? texture(ksTextureSampler, texCoord).xyz : material.ks;
-
-  // add illumination from each light source
-  for (int i = 0; i < numLights; i++) {
-    // ambient
-    color += ka * lights[i].ia;
-
-    // calculate direction and attenuation to light of specific light types
-    float attenuation = 0;
-    vec3 lightDir;  // direction toward light
-    if (lights[i].type == TYPE_POINT_LIGHT) {
-      lightDir = lights[i].pos - pos;
-      float d = length(lightDir);
-      lightDir /= d;
-      vec3 al = lights[i].al;
-      attenuation = 1/(al[0] + al[1]*d + al[2]*d*d);
-    } else if (lights[i].type == TYPE_DIR_LIGHT) {
-      attenuation = 1;
-      lightDir = -lights[i].dir;
-    } else if (lights[i].type == TYPE_SPOT_LIGHT) {
-      lightDir = lights[i].pos - pos;
-      float d = length(lightDir);
-      lightDir /= d;
-      float dotProd = -dot(lightDir, lights[i].dir);
-      if (dotProd > lights[i].cutoffDot) {
-        vec3 al = lights[i].al;
-        attenuation = pow(dotProd, lights[i].aa) / (al[0] + al[1]*d + al[2]*d*d);
-      }
-    }
-
-    // diffuse
-    color += attenuation * kd * lights[i].id * max(0.0, dot(normal, lightDir));
-    // specular
-    vec3 halfVec = normalize(viewDir + lightDir);
-    color += attenuation 
-             * ks 
-             * lights[i].is 
-             * pow(max(0.0, dot(normal, halfVec)), material.shininess);
+  vec3 ka = object.material.ka;
+  vec3 ks = hasKsMap? sampleMap(ksTextureSampler, object.mapLayers.y, texCoord).xyz : object.material.ks;
+
+  // ambient from all lights
+  color += ka * ambientIntensity;
+  // add illumination from lights reaching everything
+  for (int i = 0; i < numGlobalLights; i++) {
+    color += shadeLight(fetchLight(i), pos, normal, viewDir, kd, ks);
+  }
+  // then from lights reaching the fragment's cluster
+  uvec2 cluster = fetchCluster(pos);
+  for (uint i = 0u; i < cluster.y; i++) {
+    int index = int(texelFetch(lightIndexSampler, int(cluster.x + i)).x);
+    color += shadeLight(fetchLight(index), pos, normal, viewDir, kd, ks);
   }
   color = min(color, vec3(1.0, 1.0, 1.0));
-  // color = material.ke;
+  // color = object.material.ke;
   return vec4(color, transparency);
 }
 
@@ -138,9 +138,10 @@ vec3 calculateNormal(in vec2 texCoord, in mat3 tbnMatrix) {
   if (!hasNormalMap) {
     return normalize(fsIn.worldNormal);
   }
-  // normal in tangent space
-  vec3 tsNormal = texture(normalTextureSampler, texCoord).xyz;
-  tsNormal = 2 * tsNormal - vec3(1, 1, 1);
+  // normal in tangent space, z is rebuilt from the unit length since
+  // compressed normal maps only keep x and y
+  vec2 xy = 2 * sampleMap(normalTextureSampler, object.mapLayers.w, texCoord).xy - 1;
+  vec3 tsNormal = vec3(xy, sqrt(max(0, 1 - dot(xy, xy))));
   return normalize(tbnMatrix* tsNormal);
 }
 
@@ -150,13 +151,16 @@ vec3 calculateNormal(in vec2 texCoord, in mat3 tbnMatrix) {
 /// @param  viewDir  View direction, in tangent space
 /// @return The parallax texture coordinate
 vec2 calculateParallaxTexCoord(in vec2 texCoord, in vec3 viewDir) {
+  if (!hasParallaxMap) {
+    return texCoord;
+  }
   vec2 deltaTexCoord = viewDir.xy * parallaxScale / parallaxSteps / viewDir.z;
   vec2 curTexCoord = texCoord;
   float curDepth = 0; // depth from depth map
   float layerDepth = 0; // depth of layer we are considering
   float deltaLayerDepth = 1.0 / parallaxSteps;
   for (int i = 0; i < parallaxSteps; i++) {
-    float curDepth = texture(parallaxTextureSampler, curTexCoord).x;
+    float curDepth = sampleMap(parallaxTextureSampler, object.parallaxLayer, curTexCoord).x;
     if (layerDepth >= curDepth) {
       break;
     }
@@ -167,7 +171,11 @@ vec2 calculateParallaxTexCoord(in vec2 texCoord, in vec3 viewDir) {
 }
 
 
+// Compiled with DEPTH_ONLY for the depth pre-pass, which only writes depth
 void main() {
+#ifndef DEPTH_ONLY
+  object = objects[fsIn.objectIndex];
+
   // convert to/from tangent space using TBN (tangent, bitangent, normal) matrix
   vec3 n = normalize(fsIn.worldNormal);
   vec3 t = normalize(fsIn.worldTangent);
@@ -179,12 +187,27 @@ void main() {
   vec3 tangentViewDir = transpose(tbnMatrix) * viewDir;
   vec2 parallaxTexCoord = calculateParallaxTexCoord(fsIn.texCoord, tangentViewDir);
   
-  // if texture coordinate is out of range, don't show fragment
-  if (parallaxTexCoord.x < 0.0 || parallaxTexCoord.x > 1.0 
-      || parallaxTexCoord.y < 0.0 || parallaxTexCoord.y > 1.0) {
+  // if parallax texture coordinate is out of range, don't show fragment
+  if (hasParallaxMap 
+      && (parallaxTexCoord.x < 0.0 || parallaxTexCoord.x > 1.0 
+          || parallaxTexCoord.y < 0.0 || parallaxTexCoord.y > 1.0)) {
     discard;
   }
 
   vec3 normal = calculateNormal(parallaxTexCoord, tbnMatrix);
-  color = shadeBlinnPhong(fsIn.worldPos, normal, viewDir, parallaxTexCoord);
+  vec4 shaded = shadeBlinnPhong(fsIn.worldPos, normal, viewDir, parallaxTexCoord);
+#ifdef WEIGHTED_OIT
+  // weight by coverage and closeness to the camera, so that near fragments
+  // dominate the average color (McGuire and Bavoil 2013, equation 7). The
+  // view depth |z| is taken as the distance to the camera, which orthographic
+  // views keep meaningful too, unlike the nonlinear depth buffer value.
+  float z = length(cameraPos - fsIn.worldPos);
+  float w = shaded.a * clamp(
+      10 / (1e-5 + pow(z / 5, 2) + pow(z / 200, 6)), 1e-2, 3e3);
+  accum = vec4(shaded.rgb * w, shaded.a);
+  weight = w;
+#else
+  color = shaded;
+#endif
+#endif // DEPTH_ONLY
 }
\ No newline at end of file
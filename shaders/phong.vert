@@ -7,33 +7,60 @@
 ////////////////////////////////////////////////////////////////////////////////
 // Uniforms
 
-// Properties of the scene
-uniform mat4  viewProjectionMatrix;   // Transform from world to homogeneous coordinate
-
-// Properties of the object
-uniform mat4     vertexModelMatrix;   // Transform vertex from model to world coordinate
-uniform mat4     normalModelMatrix;   // Transform normal from model to world coordinate
+#include "uniform_blocks.glsl"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Vertex input/output
-in  vec3 modelPos;     // Vertex position in model space
-in  vec3 modelNormal;  // Vertex normal in model space
-in  vec2 texCoord;  // Texture coordinate
-in  vec3 modelTangent; // Tangent 
+layout(location = 0) in vec3 modelPos;     // Vertex position in model space
+layout(location = 1) in vec3 modelNormal;  // Vertex normal in model space
+layout(location = 2) in vec2 texCoord;     // Texture coordinate
+layout(location = 3) in vec3 modelTangent; // Tangent 
+// Per-instance attributes, replace the object model matrices if hasInstances
+layout(location = 4) in mat4 instanceVertexMatrix; // takes locations 4-7
+layout(location = 8) in mat4 instanceNormalMatrix; // takes locations 8-11
+// Index of the object in the ObjectData array, always 0 if not batched
+layout(location = 12) in int batchIndex;
 
 out VS_OUT {
   vec3 worldPos;     // Vertex position in world space
   vec3 worldNormal;  // Vertex normal in world space
   vec2 texCoord;     // Vertex's texture coordinate
   vec3 worldTangent; // Vertex tangent in world space
+  flat int objectIndex; // Index of the object in the ObjectData array
 } vsOut;
 
+// Same position in the depth pre-pass and shading programs, for GL_EQUAL depth
+// test
+invariant gl_Position;
+
+
+////////////////////////////////////////////////////////////////////////////////
+/// Decode a unit vector from its octahedral encoding
+vec3 decodeOctahedral(in vec2 e) {
+  vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (v.z < 0) {
+    v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0 ? 1 : -1, v.y >= 0 ? 1 : -1);
+  }
+  return normalize(v);
+}
+
 
 void main() {
+  object = objects[batchIndex];
+  vsOut.objectIndex = batchIndex;
+
+  // Decode vertex attributes if they are packed. Positions are always decoded
+  // since offset/scale are identity for unpacked vertices.
+  vec3 p = object.positionOffset + object.positionScale * modelPos;
+  vec3 n = hasPackedVertices ? decodeOctahedral(modelNormal.xy) : modelNormal;
+  vec3 tg = hasPackedVertices ? decodeOctahedral(modelTangent.xy) : modelTangent;
+
   // Calculate position and normal of vector in world coordinate
-  vec4 pos = vertexModelMatrix * vec4(modelPos, 1);
-  vec4 normal = normalModelMatrix * vec4(modelNormal, 0);
-  vec4 tangent = vertexModelMatrix * vec4(modelTangent, 0);
+  mat4 vertexMatrix = hasInstances ? instanceVertexMatrix : object.vertexModelMatrix;
+  mat4 normalMatrix = hasInstances ? instanceNormalMatrix : object.normalModelMatrix;
+  vec4 pos = vertexMatrix * vec4(p, 1);
+  vec4 normal = normalMatrix * vec4(n, 0);
+  vec4 tangent = vertexMatrix * vec4(tg, 0);
   vsOut.worldPos = pos.xyz;
   vsOut.worldNormal = normalize(normal.xyz);
   vsOut.worldTangent = normalize(tangent.xyz);
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+// Uniform blocks shared by the vertex and fragment shaders. Layout must match
+// UniformBlocks.h.
+////////////////////////////////////////////////////////////////////////////////
+
+// Properties of the scene, updated once per frame
+layout(std140) uniform FrameData {
+  mat4  viewProjectionMatrix; // Transform from world to homogeneous coordinate
+  mat4  viewMatrix;           // Transform from world to camera space
+  vec3  cameraPos;            // Position of camera in the world
+  int   numGlobalLights;      // Number of lights reaching every cluster
+  vec3  ambientIntensity;     // Sum of ambient intensity of all lights
+  float clusterDepthScale;    // Depth slice of view depth z is f(z)*scale-bias
+  vec2  clusterTileSize;      // Size of the screen tile of a cluster, in pixels
+  float clusterDepthBias;
+  int   isClusterDepthLog;    // f is log if set, identity otherwise
+  ivec3 clusterCounts;        // Number of clusters along x, y, depth
+};
+
+#define FLAG_TRANSPARENCY    1
+#define FLAG_KD_MAP          2
+#define FLAG_KS_MAP          4
+#define FLAG_KE_MAP          8
+#define FLAG_NORMAL_MAP      16
+#define FLAG_PARALLAX_MAP    32
+#define FLAG_PACKED_VERTICES 64
+#define FLAG_INSTANCES       128
+#define FLAG_TEXTURE_ARRAYS  256
+
+struct Material {
+  vec3  ka;
+  float shininess;
+  vec3  kd;
+  float transparency;
+  vec3  ks;
+  vec3  ke;
+};
+
+struct Object {
+  mat4     vertexModelMatrix; // Transform vertex from model to world coordinate
+  mat4     normalModelMatrix; // Transform normal from model to world coordinate
+  vec3     positionOffset;    // Decode packed position: offset + scale*p
+  int      flags;             // Combination of FLAG_* bits
+  vec3     positionScale;
+  int      parallaxLayer;     // Layer of the parallax map in its array
+  ivec4    mapLayers;         // Layers of the kd, ks, ke and normal maps in their arrays
+  Material material;          // Default material of the object, if not texture mapped
+};
+
+#define MAX_BATCH_OBJECTS 64
+
+// Properties of the objects, bound per draw. A batched draw covers several
+// objects, told apart by their index in the array.
+layout(std140) uniform ObjectData {
+  Object objects[MAX_BATCH_OBJECTS];
+};
+
+// Object being shaded, picked from objects at the start of main
+Object object;
+
+// Object features. A program specialized for a feature set defines every
+// HAS_* macro to 0 or 1, so that the branches on features are resolved at
+// compile time. Otherwise they are read from the object flags.
+#ifdef HAS_KD_MAP
+#define hasTransparency   (HAS_TRANSPARENCY != 0)
+#define hasKdMap          (HAS_KD_MAP != 0)
+#define hasKsMap          (HAS_KS_MAP != 0)
+#define hasKeMap          (HAS_KE_MAP != 0)
+#define hasNormalMap      (HAS_NORMAL_MAP != 0)
+#define hasParallaxMap    (HAS_PARALLAX_MAP != 0)
+#define hasPackedVertices (HAS_PACKED_VERTICES != 0)
+#define hasInstances      (HAS_INSTANCES != 0)
+#define hasTextureArrays  (HAS_TEXTURE_ARRAYS != 0)
+#else
+#define hasTransparency   ((object.flags & FLAG_TRANSPARENCY) != 0)    // Any part of the object is transparent?
+#define hasKdMap          ((object.flags & FLAG_KD_MAP) != 0)          // Is object Kd from texture, or material?
+#define hasKsMap          ((object.flags & FLAG_KS_MAP) != 0)          // Is object Ks from texture, or material?
+#define hasKeMap          ((object.flags & FLAG_KE_MAP) != 0)          // Is object Ke from texture, or material?
+#define hasNormalMap      ((object.flags & FLAG_NORMAL_MAP) != 0)      // Is object normal mapped?
+#define hasParallaxMap    ((object.flags & FLAG_PARALLAX_MAP) != 0)    // Is object parallax mapped?
+#define hasPackedVertices ((object.flags & FLAG_PACKED_VERTICES) != 0) // Vertices are quantized/octahedral encoded?
+#define hasInstances      ((object.flags & FLAG_INSTANCES) != 0)       // Use per-instance model matrices?
+#define hasTextureArrays  ((object.flags & FLAG_TEXTURE_ARRAYS) != 0)  // Are texture maps layers of arrays?
+#endif